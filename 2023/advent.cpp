@@ -0,0 +1,201 @@
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <common/input_error.h>
+#include <common/line_reader.h>
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/parallel.h>
+#include <common/runner.h>
+
+namespace {
+
+struct options_t {
+    int day = 0; // 0 runs every registered day
+    std::string input;
+    size_t threads = 0; // 0 uses the hardware concurrency
+    std::string metrics; // when set, write the JSON metrics report here at exit ("-" for stdout)
+    int repeat = 1;
+    bool stream = false;
+    std::string serve; // when set, answer queries on this Unix socket path ("-" for stdin and stdout)
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [--day N] [--input PATH|-] [--repeat R] [--threads T] [--metrics PATH|-] [--stream]"
+              << " [--serve SOCKET|-]" << std::endl;
+}
+
+bool parse_args(int argc, char** argv, options_t& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stream") {
+            options.stream = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--day") {
+                options.day = std::stoi(value);
+            } else if (arg == "--input") {
+                options.input = value;
+            } else if (arg == "--metrics") {
+                options.metrics = value;
+            } else if (arg == "--threads") {
+                options.threads = std::stoul(value);
+            } else if (arg == "--repeat") {
+                options.repeat = std::stoi(value);
+            } else if (arg == "--serve") {
+                options.serve = value;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (options.repeat < 1 || (!options.input.empty() && options.day == 0)) {
+        return false;
+    }
+    // stdin cannot be rewound for another streaming pass
+    if (options.stream && options.input == "-" && options.repeat > 1) {
+        return false;
+    }
+    // a server answers for one day; serving on stdin and stdout leaves them to the queries
+    if (!options.serve.empty()
+        && (options.day == 0 || (options.serve == "-" && (options.input == "-" || options.metrics == "-")))) {
+        return false;
+    }
+    return true;
+}
+
+void print_phase(const char* name, const std::vector<double>& samples) {
+    auto stats = advent::runner::summarize(samples);
+    std::printf("  %-6s min %10.3f ms  median %10.3f ms  p99 %10.3f ms\n",
+                name, stats.min * 1e3, stats.median * 1e3, stats.p99 * 1e3);
+}
+
+bool stream_day(const advent::runner::day_t& day, const std::string& path, const options_t& options) {
+    std::vector<double> stream_times;
+    std::pair<std::string, std::string> answers;
+    size_t buffer_size = 0ul;
+    for (int r = 0; r < options.repeat; r++) {
+        advent::io::line_reader_t lines(path);
+        if (!lines.is_open()) {
+            std::cout << "Cannot open input file " << path << std::endl;
+            return false;
+        }
+        stream_times.push_back(advent::runner::time_phase([&] { answers = day.stream(lines); }));
+        if (lines.failed()) {
+            std::cout << "Error reading input file " << path << std::endl;
+            return false;
+        }
+        buffer_size = lines.buffer_size();
+    }
+
+    std::cout << "Day " << day.day << " (streamed, " << buffer_size << " byte line buffer)" << std::endl;
+    std::cout << "Part 1: " << answers.first << std::endl;
+    std::cout << "Part 2: " << answers.second << std::endl;
+    std::cout << "Timing over " << options.repeat << " repeat(s):" << std::endl;
+    print_phase("stream", stream_times);
+    return true;
+}
+
+bool run_day(const advent::runner::day_t& day, const options_t& options) {
+    const auto& path = options.input.empty() ? day.default_input : options.input;
+    if (options.stream) {
+        if (day.stream) {
+            return stream_day(day, path, options);
+        }
+        std::cerr << "Day " << day.day << " has no streaming solver; reading the whole input" << std::endl;
+    }
+    advent::io::mapped_file_t input_file(path);
+    if (!input_file.is_open()) {
+        std::cout << "Cannot open input file " << path << std::endl;
+        return false;
+    }
+
+    std::vector<double> parse_times, part1_times, part2_times;
+    std::string part1_answer, part2_answer;
+    for (int r = 0; r < options.repeat; r++) {
+        std::shared_ptr<void> state;
+        parse_times.push_back(advent::runner::time_phase([&] { state = day.parse(input_file.data()); }));
+        part1_times.push_back(advent::runner::time_phase([&] { part1_answer = day.part1(state.get()); }));
+        part2_times.push_back(advent::runner::time_phase([&] { part2_answer = day.part2(state.get()); }));
+    }
+
+    std::cout << "Day " << day.day << std::endl;
+    std::cout << "Part 1: " << part1_answer << std::endl;
+    std::cout << "Part 2: " << part2_answer << std::endl;
+    std::cout << "Timing over " << options.repeat << " repeat(s):" << std::endl;
+    print_phase("parse", parse_times);
+    print_phase("part1", part1_times);
+    print_phase("part2", part2_times);
+    return true;
+}
+
+bool serve_day(const advent::runner::day_t& day, const options_t& options) {
+    if (!day.serve) {
+        std::cerr << "Day " << day.day << " has no query server" << std::endl;
+        return false;
+    }
+    const auto& path = options.input.empty() ? day.default_input : options.input;
+    advent::io::mapped_file_t input_file(path);
+    if (!input_file.is_open()) {
+        std::cerr << "Cannot open input file " << path << std::endl;
+        return false;
+    }
+    advent::server::handler_t handler;
+    auto prepare_time = advent::runner::time_phase([&] { handler = day.serve(input_file.data()); });
+    std::fprintf(stderr, "Day %d input prepared in %.3f ms\n", day.day, prepare_time * 1e3);
+    return advent::server::serve(options.serve, handler);
+}
+
+// Runs one of the day drivers above, turning a malformed input into a failed day.
+bool guard_input(bool (*driver)(const advent::runner::day_t&, const options_t&), const advent::runner::day_t& day,
+                 const options_t& options) {
+    try {
+        return driver(day, options);
+    } catch (const advent::io::input_error_t& e) {
+        std::cout << "Day " << day.day << ": malformed input: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    options_t options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    advent::parallel::set_num_threads(options.threads);
+    if (!options.metrics.empty()) {
+        advent::metrics::report_at_exit(options.metrics);
+    }
+
+    const auto& registry = advent::runner::registry_t::instance();
+    if (options.day != 0) {
+        auto day = registry.find(options.day);
+        if (!day) {
+            std::cerr << "No solution registered for day " << options.day << std::endl;
+            return 1;
+        }
+        if (!options.serve.empty()) {
+            return guard_input(serve_day, *day, options) ? 0 : 1;
+        }
+        return guard_input(run_day, *day, options) ? 0 : 1;
+    }
+
+    bool ok = true;
+    for (const auto& [n, day] : registry.days()) {
+        ok = guard_input(run_day, day, options) && ok;
+    }
+    return ok ? 0 : 1;
+}
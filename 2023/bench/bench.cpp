@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/parallel.h>
+#include <common/runner.h>
+
+#include "../solutions/day2/game_store.h"
+#include "../solutions/day5/range_map.h"
+#include "../solutions/day6/race.h"
+#include "generators.h"
+
+namespace {
+
+struct options_t {
+    int day = 0; // 0 benchmarks every day with a generator
+    uint64_t size = 0; // 0 uses the generator's default
+    uint64_t seed = 2023;
+    size_t threads = 0; // 0 uses the hardware concurrency
+    std::string metrics; // when set, write the JSON metrics report here at exit ("-" for stdout)
+    int repeat = 5;
+    uint64_t queries = 0; // days 2, 5 and 6: when set, time this many queries against the day's query structure
+    std::string output; // when set, only write the generated input here ("-" for stdout)
+    bool large = false; // use each generator's large size instead of its default
+};
+
+void print_usage(const char* argv0) {
+    std::cerr << "usage: " << argv0
+              << " [--day N] [--size S|--large] [--seed X] [--repeat R] [--threads T] [--output PATH|-] [--metrics PATH|-]"
+              << " [--queries Q]" << std::endl;
+    std::cerr << "sizes:" << std::endl;
+    for (const auto& [day, generator] : advent::bench::generators()) {
+        std::cerr << "  day " << day << ": " << generator.size_unit << " (default " << generator.default_size
+                  << ", large " << generator.large_size << ")" << std::endl;
+    }
+}
+
+bool parse_args(int argc, char** argv, options_t& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--large") {
+            options.large = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (arg == "--day") {
+                options.day = std::stoi(value);
+            } else if (arg == "--size") {
+                options.size = std::stoull(value);
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (arg == "--queries") {
+                options.queries = std::stoull(value);
+            } else if (arg == "--metrics") {
+                options.metrics = value;
+            } else if (arg == "--threads") {
+                options.threads = std::stoul(value);
+            } else if (arg == "--repeat") {
+                options.repeat = std::stoi(value);
+            } else if (arg == "--output") {
+                options.output = value;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    if (options.repeat < 1 || (!options.output.empty() && options.day == 0)
+        || (options.queries != 0 && options.day != 2 && options.day != 5 && options.day != 6)) {
+        return false;
+    }
+    return true;
+}
+
+void print_phase(const char* name, const std::vector<double>& samples, size_t bytes, size_t lines) {
+    auto stats = advent::runner::summarize(samples);
+    auto seconds = std::max(stats.median, 1e-9);
+    std::printf("  %-6s median %12.3f ms  p99 %12.3f ms  %10.1f MB/s  %14.0f lines/s\n",
+                name, stats.median * 1e3, stats.p99 * 1e3, bytes / seconds / 1e6, lines / seconds);
+}
+
+uint64_t input_size(const advent::bench::generator_t& generator, const options_t& options) {
+    if (options.size) {
+        return options.size;
+    }
+    return options.large ? generator.large_size : generator.default_size;
+}
+
+bool write_input(const advent::bench::generator_t& generator, const options_t& options) {
+    auto file = options.output == "-" ? stdout : std::fopen(options.output.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot open output file " << options.output << std::endl;
+        return false;
+    }
+    {
+        advent::bench::rng_t rng(options.seed);
+        advent::bench::writer_t out(file);
+        generator.generate(input_size(generator, options), rng, out);
+    }
+    return file == stdout ? std::fflush(file) == 0 : std::fclose(file) == 0;
+}
+
+// Streams the generated input into an unlinked temporary file under $TMPDIR (default /tmp) and maps it, so
+// large inputs live in the page cache instead of the heap and are never held twice while generating.
+advent::io::mapped_file_t generate_input(const advent::bench::generator_t& generator, const options_t& options) {
+    auto dir = std::getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/advent_bench_XXXXXX";
+    auto fd = ::mkstemp(path.data());
+    auto file = fd >= 0 ? ::fdopen(fd, "wb") : nullptr;
+    bool written = file != nullptr;
+    if (written) {
+        {
+            advent::bench::rng_t rng(options.seed);
+            advent::bench::writer_t out(file);
+            generator.generate(input_size(generator, options), rng, out);
+        }
+        written = std::ferror(file) == 0;
+        written = std::fclose(file) == 0 && written;
+    } else if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!written) {
+        std::cerr << "Cannot write the generated input to " << path << ": " << std::strerror(errno) << std::endl;
+        ::unlink(path.c_str());
+        std::exit(1);
+    }
+    advent::io::mapped_file_t input(path);
+    ::unlink(path.c_str());
+    return input;
+}
+
+void bench_day(const advent::runner::day_t& day, const advent::bench::generator_t& generator,
+               const options_t& options) {
+    auto size = input_size(generator, options);
+
+    std::string_view input;
+    std::unique_ptr<advent::io::mapped_file_t> input_file;
+    auto generate_time = advent::runner::time_phase([&] {
+        input_file = std::make_unique<advent::io::mapped_file_t>(generate_input(generator, options));
+        input = input_file->data();
+    });
+    auto lines = static_cast<size_t>(std::count(input.cbegin(), input.cend(), '\n'));
+
+    std::printf("Day %d: %llu %s, %.1f MB, %zu lines (generated in %.3f s)\n", day.day,
+                static_cast<unsigned long long>(size), generator.size_unit, input.size() / 1e6, lines,
+                generate_time);
+
+    std::vector<double> parse_times, part1_times, part2_times;
+    std::string part1_answer, part2_answer;
+    for (int r = 0; r < options.repeat; r++) {
+        std::shared_ptr<void> state;
+        parse_times.push_back(advent::runner::time_phase([&] { state = day.parse(input); }));
+        part1_times.push_back(advent::runner::time_phase([&] { part1_answer = day.part1(state.get()); }));
+        part2_times.push_back(advent::runner::time_phase([&] { part2_answer = day.part2(state.get()); }));
+    }
+
+    std::cout << "  Part 1: " << part1_answer << "  Part 2: " << part2_answer << std::endl;
+    print_phase("parse", parse_times, input.size(), lines);
+    print_phase("part1", part1_times, input.size(), lines);
+    print_phase("part2", part2_times, input.size(), lines);
+}
+
+// Parses the generated games once into the column store, then answers random bags in batches and one
+// at a time.
+void bench_day2_queries(const advent::bench::generator_t& generator, const options_t& options) {
+    constexpr size_t batch_size = 64ul;
+
+    day2::game_store_t games;
+    size_t input_bytes = 0ul;
+    double parse_time = 0.0;
+    {
+        auto input_file = generate_input(generator, options);
+        input_bytes = input_file.data().size();
+        parse_time = advent::runner::time_phase([&] { games = day2::game_store_t::parse(input_file.data()); });
+    }
+    std::printf("Day 2: %zu games, %.1f MB, parsed into the store in %.3f s\n", games.size(), input_bytes / 1e6,
+                parse_time);
+
+    advent::bench::rng_t rng(options.seed + 1ull);
+    std::vector<day2::dice_t> bags(options.queries);
+    for (auto& bag : bags) {
+        bag.red = static_cast<int>(rng.uniform(0ull, 20ull));
+        bag.green = static_cast<int>(rng.uniform(0ull, 20ull));
+        bag.blue = static_cast<int>(rng.uniform(0ull, 20ull));
+    }
+
+    std::vector<uint64_t> batched(bags.size()), single(bags.size());
+    std::vector<double> batched_times, single_times;
+    for (int r = 0; r < options.repeat; r++) {
+        batched_times.push_back(advent::runner::time_phase([&] {
+            for (size_t q = 0ul; q < bags.size(); q += batch_size) {
+                games.sum_possible(bags.data() + q, std::min(batch_size, bags.size() - q), batched.data() + q);
+            }
+        }));
+        single_times.push_back(advent::runner::time_phase([&] {
+            for (size_t q = 0ul; q < bags.size(); q++) {
+                single[q] = games.sum_possible(bags[q]);
+            }
+        }));
+    }
+    if (batched != single) {
+        std::cerr << "Batched and single query answers differ" << std::endl;
+    }
+
+    auto print_queries = [&](const char* name, const std::vector<double>& samples) {
+        auto stats = advent::runner::summarize(samples);
+        auto seconds = std::max(stats.median, 1e-9);
+        std::printf("  %-8s median %12.3f ms  p99 %12.3f ms  %14.0f queries/s  %10.1f Mgames/s\n", name,
+                    stats.median * 1e3, stats.p99 * 1e3, bags.size() / seconds,
+                    bags.size() * games.size() / seconds / 1e6);
+    };
+    std::printf("  %llu queries, batches of %zu\n", static_cast<unsigned long long>(bags.size()), batch_size);
+    print_queries("batched", batched_times);
+    print_queries("single", single_times);
+}
+
+// Builds one range map of `--size` entries (default 10^6) over random, partly gapped source ranges, then
+// times chains of point lookups through it, each lookup depending on the last so the time per lookup is
+// its latency, and the same sources answered in one lookup_batch call per available kernel. Last come
+// range queries, one per 64 lookups over up to 2^16 sources each, answered both from the segments they
+// span with min_lookup and by propagating them as interval sets.
+void bench_day5_lookups(const options_t& options) {
+    auto num_entries = options.size ? options.size : 1000000ull;
+    advent::bench::rng_t rng(options.seed);
+    day5::range_map_t map;
+    uint64_t start = 0ull;
+    for (uint64_t i = 0ull; i < num_entries; i++) {
+        start += rng.uniform(0ull, 1ull) * rng.uniform(1ull, 1024ull);
+        auto length = rng.uniform(1ull, 2048ull);
+        map.insert(day5::range_entry_t(start, rng.uniform(0ull, 1ull << 40), length));
+        start += length;
+    }
+    auto build_time = advent::runner::time_phase([&] { map.build(); });
+    std::printf("Day 5: one map of %zu entries, %zu segments, built in %.3f s\n", map.size(), map.num_segments(),
+                build_time);
+
+    std::vector<uint64_t> sources(options.queries);
+    for (auto& s : sources) {
+        s = rng.uniform(0ull, start);
+    }
+
+    auto time_chain = [&](auto lookup) {
+        uint64_t last = 0ull;
+        auto seconds = advent::runner::time_phase([&] {
+            for (auto s : sources) {
+                last = lookup(s + (last & 1ull));
+            }
+        });
+        // keeps the chain from being optimized away
+        if (last == ~0ull) {
+            std::cerr << "unreachable" << std::endl;
+        }
+        return seconds;
+    };
+
+    auto print_lookups = [&](const char* name, const std::vector<double>& samples, size_t n) {
+        auto stats = advent::runner::summarize(samples);
+        std::printf("  %-10s median %10.1f ns/lookup  p99 %10.1f ns/lookup  %14.0f lookups/s\n", name,
+                    stats.median * 1e9 / n, stats.p99 * 1e9 / n, n / std::max(stats.median, 1e-9));
+    };
+
+    using kernel_t = day5::range_map_t::batch_kernel_t;
+    const std::pair<kernel_t, const char*> kernels[] = {
+        {kernel_t::scalar, "scalar"}, {kernel_t::avx2, "avx2"}, {kernel_t::avx512, "avx512"}};
+    std::vector<uint64_t> expected(sources.size()), results(sources.size());
+    for (size_t i = 0ul; i < sources.size(); i++) {
+        expected[i] = map.lookup(sources[i]);
+    }
+
+    std::vector<double> sorted_times, eytzinger_times, batch_times[3];
+    auto has_eytzinger = map.num_segments() >= day5::range_map_t::eytzinger_min_segments;
+    for (int r = 0; r < options.repeat; r++) {
+        sorted_times.push_back(time_chain([&map](uint64_t s) { return map.lookup_sorted(s); }));
+        if (has_eytzinger) {
+            eytzinger_times.push_back(time_chain([&map](uint64_t s) { return map.lookup_eytzinger(s); }));
+        }
+        for (size_t k = 0ul; k < 3ul; k++) {
+            if (!day5::range_map_t::supports(kernels[k].first)) {
+                continue;
+            }
+            batch_times[k].push_back(advent::runner::time_phase(
+                [&] { map.lookup_batch(sources.data(), sources.size(), results.data(), kernels[k].first); }));
+            if (results != expected) {
+                std::cerr << "Batched " << kernels[k].second << " lookups differ" << std::endl;
+            }
+        }
+    }
+    std::printf("  %llu dependent lookups\n", static_cast<unsigned long long>(sources.size()));
+    print_lookups("sorted", sorted_times, sources.size());
+    if (has_eytzinger) {
+        print_lookups("eytzinger", eytzinger_times, sources.size());
+    }
+    std::printf("  %llu batched lookups on %zu thread(s)\n", static_cast<unsigned long long>(sources.size()),
+                advent::parallel::num_threads());
+    for (size_t k = 0ul; k < 3ul; k++) {
+        if (!batch_times[k].empty()) {
+            print_lookups(kernels[k].second, batch_times[k], sources.size());
+        }
+    }
+
+    std::vector<day5::range_t> ranges(std::max(sources.size() / 64ul, size_t{1}));
+    for (auto& r : ranges) {
+        auto first = rng.uniform(0ull, start);
+        r = day5::range_t{first, first + rng.uniform(1ull, 1ull << 16)};
+    }
+    std::vector<uint64_t> range_expected(ranges.size()), range_results(ranges.size());
+    day5::range_buffers_t buffers;
+    std::vector<double> min_lookup_times, propagate_times;
+    for (int r = 0; r < options.repeat; r++) {
+        min_lookup_times.push_back(advent::runner::time_phase([&] {
+            for (size_t i = 0ul; i < ranges.size(); i++) {
+                range_expected[i] = map.min_lookup(ranges[i]);
+            }
+        }));
+        propagate_times.push_back(advent::runner::time_phase([&] {
+            for (size_t i = 0ul; i < ranges.size(); i++) {
+                range_results[i] = day5::propagate_min(&map, 1ul, &ranges[i], 1ul, buffers);
+            }
+        }));
+        if (range_results != range_expected) {
+            std::cerr << "Propagated range minima differ" << std::endl;
+        }
+    }
+    std::printf("  %zu range queries\n", ranges.size());
+    print_lookups("min_lookup", min_lookup_times, ranges.size());
+    print_lookups("propagate", propagate_times, ranges.size());
+}
+
+// Solves `--queries` random races whose times are spread evenly over every magnitude up to 2^64, with
+// records anywhere from 0 to the best possible distance, in blocks of 2^16. Every answer is checked
+// exactly: the first and last winning hold times must beat the record and their outer neighbours must
+// not. The double-precision formula the solver replaced is counted against the same races.
+void bench_day6_races(const options_t& options) {
+    constexpr size_t block_size = 1ul << 16;
+    using uint128_t = day6::uint128_t;
+    advent::bench::rng_t rng(options.seed);
+    std::vector<day6::race_t> races(block_size);
+    std::vector<uint64_t> ways(block_size);
+
+    auto beats = [](const day6::race_t& race, uint128_t hold) {
+        return hold <= race.time && hold * (race.time - hold) > race.distance;
+    };
+    auto exact = [&beats](const day6::race_t& race, uint64_t n) {
+        if (n == 0ull) {
+            return !beats(race, race.time / 2ull) && !beats(race, race.time / 2ull + 1ull);
+        }
+        // the winning holds are n consecutive values centred on time / 2
+        auto twice_first = static_cast<uint128_t>(race.time) - (n - 1ull);
+        auto first = twice_first / 2u;
+        auto last = first + (n - 1ull);
+        return (twice_first & 1u) == 0u && beats(race, first) && beats(race, last)
+               && (first == 0u || !beats(race, first - 1u)) && !beats(race, last + 1u);
+    };
+    auto double_num_ways = [](const day6::race_t& race) {
+        auto discriminant = race.time * race.time - 4ull * race.distance;
+        auto start = std::ceil((static_cast<double>(race.time) - std::sqrt(discriminant)) / 2.0);
+        auto last = std::floor((static_cast<double>(race.time) + std::sqrt(discriminant)) / 2.0);
+        return static_cast<uint64_t>(last - start + 1.0);
+    };
+
+    std::vector<double> block_times;
+    double total_time = 0.0;
+    uint64_t wrong = 0ull, double_wrong = 0ull;
+    for (uint64_t done = 0ull; done < options.queries; done += block_size) {
+        auto n = static_cast<size_t>(std::min<uint64_t>(block_size, options.queries - done));
+        for (size_t i = 0ul; i < n; i++) {
+            auto time = rng.next() >> rng.uniform(0ull, 63ull);
+            auto best = static_cast<uint128_t>(time) * time / 4u;
+            races[i] = {time, rng.uniform(0ull, best > ~0ull ? ~0ull : static_cast<uint64_t>(best))};
+        }
+        auto seconds = advent::runner::time_phase([&] {
+            for (size_t i = 0ul; i < n; i++) {
+                ways[i] = day6::calc_num_ways(races[i]);
+            }
+        });
+        block_times.push_back(seconds / n);
+        total_time += seconds;
+        for (size_t i = 0ul; i < n; i++) {
+            wrong += !exact(races[i], ways[i]);
+            double_wrong += double_num_ways(races[i]) != ways[i];
+        }
+    }
+
+    auto stats = advent::runner::summarize(block_times);
+    std::printf("Day 6: %llu races, times up to 2^64\n", static_cast<unsigned long long>(options.queries));
+    std::printf("  exact    total %10.3f s  median %6.2f ns/race  p99 %6.2f ns/race  %14.0f races/s\n", total_time,
+                stats.median * 1e9, stats.p99 * 1e9, options.queries / std::max(total_time, 1e-9));
+    std::printf("  %llu wrong answers; the double formula gets %llu wrong\n", static_cast<unsigned long long>(wrong),
+                static_cast<unsigned long long>(double_wrong));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    options_t options;
+    if (!parse_args(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    advent::parallel::set_num_threads(options.threads);
+    if (!options.metrics.empty()) {
+        advent::metrics::report_at_exit(options.metrics);
+    }
+
+    const auto& registry = advent::runner::registry_t::instance();
+    if (options.day != 0) {
+        auto generator = advent::bench::find_generator(options.day);
+        auto day = registry.find(options.day);
+        if (!generator || !day) {
+            std::cerr << "No generator or solution for day " << options.day << std::endl;
+            return 1;
+        }
+        if (!options.output.empty()) {
+            return write_input(*generator, options) ? 0 : 1;
+        }
+        if (options.queries != 0) {
+            if (options.day == 2) {
+                bench_day2_queries(*generator, options);
+            } else if (options.day == 5) {
+                bench_day5_lookups(options);
+            } else {
+                bench_day6_races(options);
+            }
+            return 0;
+        }
+        bench_day(*day, *generator, options);
+        return 0;
+    }
+
+    for (const auto& [n, generator] : advent::bench::generators()) {
+        if (auto day = registry.find(n)) {
+            bench_day(*day, generator, options);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,351 @@
+#include "generators.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+namespace advent {
+namespace bench {
+
+void writer_t::write_number(uint64_t v, int width) {
+    char digits[24];
+    auto res = std::to_chars(digits, digits + sizeof(digits), v);
+    for (auto n = res.ptr - digits; n < width; n++) {
+        _buffer.push_back(' ');
+    }
+    _buffer.append(digits, res.ptr);
+    maybe_flush();
+}
+
+void writer_t::flush() {
+    if (_file && !_buffer.empty()) {
+        std::fwrite(_buffer.data(), 1, _buffer.size(), _file);
+        _buffer.clear();
+    }
+}
+
+namespace {
+
+constexpr std::array<std::string_view, 10> spelled_digits = {
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine",
+};
+
+int num_digits(uint64_t v) {
+    int n = 1;
+    while (v >= 10ull) {
+        v /= 10ull;
+        n++;
+    }
+    return n;
+}
+
+template <typename T>
+void shuffle(std::vector<T>& v, rng_t& rng) {
+    for (size_t i = v.size(); i > 1ul; i--) {
+        std::swap(v[i - 1ul], v[rng.uniform(0ull, i - 1ul)]);
+    }
+}
+
+// size: lines
+void generate_day1(uint64_t size, rng_t& rng, writer_t& out) {
+    for (uint64_t i = 0; i < size; i++) {
+        auto length = rng.uniform(5ull, 40ull);
+        bool has_digit = false;
+        uint64_t written = 0ull;
+        while (written < length || !has_digit) {
+            auto kind = rng.uniform(0ull, 9ull);
+            if (kind < 2ull) {
+                out.put(static_cast<char>('1' + rng.uniform(0ull, 8ull)));
+                has_digit = true;
+                written++;
+            } else if (kind < 4ull) {
+                auto word = spelled_digits[rng.uniform(1ull, 9ull)];
+                out.write(word);
+                written += word.size();
+            } else {
+                out.put(static_cast<char>('a' + rng.uniform(0ull, 25ull)));
+                written++;
+            }
+        }
+        out.put('\n');
+    }
+}
+
+// size: games
+void generate_day2(uint64_t size, rng_t& rng, writer_t& out) {
+    constexpr std::array<std::string_view, 3> colors = {"red", "green", "blue"};
+    for (uint64_t id = 1; id <= size; id++) {
+        out.write("Game ");
+        out.write_number(id);
+        out.put(':');
+        auto rounds = rng.uniform(1ull, 6ull);
+        for (uint64_t r = 0; r < rounds; r++) {
+            std::array<size_t, 3> order = {0ul, 1ul, 2ul};
+            for (size_t i = 2ul; i > 0ul; i--) {
+                std::swap(order[i], order[rng.uniform(0ull, i)]);
+            }
+            auto num_colors = rng.uniform(1ull, 3ull);
+            for (uint64_t c = 0; c < num_colors; c++) {
+                out.write(c == 0 ? " " : ", ");
+                out.write_number(rng.uniform(1ull, 20ull));
+                out.put(' ');
+                out.write(colors[order[c]]);
+            }
+            if (r + 1ull < rounds) {
+                out.put(';');
+            }
+        }
+        out.put('\n');
+    }
+}
+
+// size: rows and columns of a square schematic
+void generate_day3(uint64_t size, rng_t& rng, writer_t& out) {
+    constexpr std::string_view symbols = "*#+$/@%=&-*";
+    for (uint64_t i = 0; i < size; i++) {
+        uint64_t j = 0;
+        while (j < size) {
+            auto roll = rng.uniform(0ull, 99ull);
+            if (roll < 10ull && j + 1ull < size) {
+                // a number always ends on a non-digit so it cannot merge with the next one
+                auto length = std::min<uint64_t>(rng.uniform(1ull, 3ull), size - j - 1ull);
+                out.put(static_cast<char>('1' + rng.uniform(0ull, 8ull)));
+                for (uint64_t k = 1; k < length; k++) {
+                    out.put(static_cast<char>('0' + rng.uniform(0ull, 9ull)));
+                }
+                out.put('.');
+                j += length + 1ull;
+            } else if (roll < 14ull) {
+                out.put(symbols[rng.uniform(0ull, symbols.size() - 1ull)]);
+                j++;
+            } else {
+                out.put('.');
+                j++;
+            }
+        }
+        out.put('\n');
+    }
+}
+
+// size: cards
+void generate_day4(uint64_t size, rng_t& rng, writer_t& out) {
+    constexpr size_t num_winning = 10ul;
+    constexpr size_t num_test = 25ul;
+    auto id_width = std::max(3, num_digits(size));
+
+    std::vector<uint64_t> numbers(99);
+    std::iota(numbers.begin(), numbers.end(), 1ull);
+    for (uint64_t id = 1; id <= size; id++) {
+        // keep the expected match count below one so part 2's copy counts stay bounded
+        auto roll = rng.uniform(0ull, 99ull);
+        uint64_t matches = roll < 70ull ? 0ull
+            : roll < 85ull ? 1ull
+            : roll < 93ull ? 2ull
+            : rng.uniform(3ull, num_winning);
+        matches = std::min(matches, size - id);
+
+        // partial shuffle: [0, 10) are the winners, [10, 35 - matches) the non-matching test numbers
+        for (size_t i = 0ul; i < num_winning + num_test; i++) {
+            std::swap(numbers[i], numbers[rng.uniform(i, numbers.size() - 1ul)]);
+        }
+
+        out.write("Card ");
+        out.write_number(id, id_width);
+        out.put(':');
+        for (size_t i = 0ul; i < num_winning; i++) {
+            out.put(' ');
+            out.write_number(numbers[i], 2);
+        }
+        out.write(" |");
+        for (size_t i = 0ul; i < num_test; i++) {
+            out.put(' ');
+            out.write_number(i < matches ? numbers[i] : numbers[num_winning + i], 2);
+        }
+        out.put('\n');
+    }
+}
+
+// size: total map entries across the seven maps
+void generate_day5(uint64_t size, rng_t& rng, writer_t& out) {
+    constexpr std::array<std::string_view, 7> names = {
+        "seed-to-soil", "soil-to-fertilizer", "fertilizer-to-water", "water-to-light",
+        "light-to-temperature", "temperature-to-humidity", "humidity-to-location",
+    };
+    constexpr uint64_t space = 1ull << 32;
+
+    out.write("seeds:");
+    for (int i = 0; i < 10; i++) {
+        out.put(' ');
+        out.write_number(rng.uniform(0ull, space - 1ull));
+        out.put(' ');
+        out.write_number(rng.uniform(1ull, 1ull << 27));
+    }
+    out.put('\n');
+
+    auto per_map = std::max<uint64_t>(1ull, size / names.size());
+    std::vector<uint64_t> cuts;
+    std::vector<size_t> order;
+    for (auto name : names) {
+        out.put('\n');
+        out.write(name);
+        out.write(" map:\n");
+
+        // partition [0, space) into per_map segments, then lay the segments out in a shuffled order to
+        // get the destinations; every map is a bijection with no overlapping sources or destinations
+        std::unordered_set<uint64_t> seen;
+        cuts.clear();
+        cuts.push_back(0ull);
+        while (cuts.size() < per_map) {
+            if (auto c = rng.uniform(1ull, space - 1ull); seen.insert(c).second) {
+                cuts.push_back(c);
+            }
+        }
+        std::sort(cuts.begin(), cuts.end());
+        cuts.push_back(space);
+
+        order.resize(per_map);
+        std::iota(order.begin(), order.end(), 0ul);
+        shuffle(order, rng);
+
+        std::vector<uint64_t> destinations(per_map);
+        uint64_t next = 0ull;
+        for (auto s : order) {
+            destinations[s] = next;
+            next += cuts[s + 1ul] - cuts[s];
+        }
+
+        shuffle(order, rng);
+        for (auto s : order) {
+            out.write_number(destinations[s]);
+            out.put(' ');
+            out.write_number(cuts[s]);
+            out.put(' ');
+            out.write_number(cuts[s + 1ul] - cuts[s]);
+            out.put('\n');
+        }
+    }
+}
+
+// size: races; part 2 concatenates every column, so at most four are generated to stay within 64 bits
+void generate_day6(uint64_t size, rng_t& rng, writer_t& out) {
+    auto num_races = std::clamp<uint64_t>(size, 1ull, 4ull);
+    std::vector<uint64_t> times(num_races);
+    std::vector<uint64_t> distances(num_races);
+    for (uint64_t i = 0; i < num_races; i++) {
+        times[i] = rng.uniform(7ull, 99ull);
+        // at most t^2/5 keeps the concatenated record beatable too
+        distances[i] = rng.uniform(1ull, times[i] * times[i] / 5ull);
+    }
+    out.write("Time:    ");
+    for (auto t : times) {
+        out.write_number(t, 7);
+    }
+    out.write("\nDistance:");
+    for (auto d : distances) {
+        out.write_number(d, 7);
+    }
+    out.put('\n');
+}
+
+// size: hands
+void generate_day7(uint64_t size, rng_t& rng, writer_t& out) {
+    constexpr std::string_view cards = "23456789TJQKA";
+    for (uint64_t i = 0; i < size; i++) {
+        for (int c = 0; c < 5; c++) {
+            out.put(cards[rng.uniform(0ull, cards.size() - 1ull)]);
+        }
+        out.put(' ');
+        out.write_number(rng.uniform(1ull, 1000ull));
+        out.put('\n');
+    }
+}
+
+// size: instruction length; the network always has all 26^3 nodes
+void generate_day8(uint64_t size, rng_t& rng, writer_t& out) {
+    constexpr size_t num_nodes = 26ul * 26ul * 26ul;
+    auto seq_length = std::max<uint64_t>(size, 1ull);
+
+    std::vector<bool> seq(seq_length);
+    for (uint64_t i = 0; i < seq_length; i++) {
+        seq[i] = rng.chance(0.5);
+        out.put(seq[i] ? 'R' : 'L');
+    }
+    out.write("\n\n");
+
+    std::vector<std::array<size_t, 2>> neighbors(num_nodes);
+    for (auto& n : neighbors) {
+        n = {rng.uniform(0ull, num_nodes - 1ull), rng.uniform(0ull, num_nodes - 1ull)};
+    }
+
+    // walk from node 0 (AAA) until the (node, instruction) state repeats and pick one of the nodes on
+    // that walk as ZZZ, so part 1 is guaranteed to terminate
+    std::unordered_set<uint64_t> states;
+    std::vector<size_t> path;
+    size_t cur = 0ul;
+    for (uint64_t step = 0; states.insert(cur * seq_length + step % seq_length).second; step++) {
+        cur = neighbors[cur][seq[step % seq_length]];
+        if (cur != 0ul) {
+            path.push_back(cur);
+        }
+    }
+    if (path.empty()) {
+        neighbors[0] = {1ul, 1ul};
+        path.push_back(1ul);
+    }
+    auto end_node = path[rng.uniform(0ull, path.size() - 1ul)];
+
+    // node i is named names[i]; node 0 is AAA and end_node is ZZZ
+    std::vector<size_t> names(num_nodes);
+    std::iota(names.begin(), names.end(), 0ul);
+    shuffle(names, rng);
+    std::swap(names[0], *std::find(names.begin(), names.end(), 0ul));
+    std::swap(names[end_node], *std::find(names.begin(), names.end(), num_nodes - 1ul));
+
+    auto write_name = [&out](size_t name) {
+        out.put(static_cast<char>('A' + name / 676ul));
+        out.put(static_cast<char>('A' + name / 26ul % 26ul));
+        out.put(static_cast<char>('A' + name % 26ul));
+    };
+
+    std::vector<size_t> order(num_nodes);
+    std::iota(order.begin(), order.end(), 0ul);
+    shuffle(order, rng);
+    for (auto n : order) {
+        write_name(names[n]);
+        out.write(" = (");
+        write_name(names[neighbors[n][0]]);
+        out.write(", ");
+        write_name(names[neighbors[n][1]]);
+        out.write(")\n");
+    }
+}
+
+} // namespace
+
+const std::map<int, generator_t>& generators() {
+    static const std::map<int, generator_t> all = {
+        {1, {1, 1000000ull, 100000000ull, "lines", generate_day1}},
+        {2, {2, 1000000ull, 100000000ull, "games", generate_day2}},
+        {3, {3, 2000ull, 100000ull, "rows x columns", generate_day3}},
+        {4, {4, 1000000ull, 100000000ull, "cards", generate_day4}},
+        {5, {5, 10000ull, 1000000ull, "map entries", generate_day5}},
+        {6, {6, 4ull, 4ull, "races", generate_day6}},
+        {7, {7, 100000ull, 100000000ull, "hands", generate_day7}},
+        {8, {8, 1000ull, 100000ull, "instructions", generate_day8}},
+    };
+    return all;
+}
+
+const generator_t* find_generator(int day) {
+    const auto& all = generators();
+    if (auto itr = all.find(day); itr != all.end()) {
+        return &itr->second;
+    }
+    return nullptr;
+}
+
+} // namespace bench
+} // namespace advent
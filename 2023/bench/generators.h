@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace advent {
+namespace bench {
+
+// splitmix64; deterministic across platforms and standard libraries, unlike the std distributions.
+class rng_t {
+public:
+    explicit rng_t(uint64_t seed) : _state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (_state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [lo, hi]
+    uint64_t uniform(uint64_t lo, uint64_t hi) {
+        auto span = hi - lo + 1ull;
+        if (span == 0ull) {
+            return next();
+        }
+        return lo + static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * span) >> 64);
+    }
+
+    bool chance(double p) {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53 < p;
+    }
+
+private:
+    uint64_t _state;
+};
+
+// Buffered sink for generated input; appends to a string or streams to a FILE* so inputs larger than
+// memory can be piped straight into the runner.
+class writer_t {
+public:
+    explicit writer_t(std::string& buffer) : _buffer(buffer) {}
+    explicit writer_t(std::FILE* file) : _buffer(_owned), _file(file) {}
+    ~writer_t() { flush(); }
+
+    void put(char c) {
+        _buffer.push_back(c);
+        maybe_flush();
+    }
+
+    void write(std::string_view s) {
+        _buffer.append(s);
+        maybe_flush();
+    }
+
+    void write_number(uint64_t v, int width = 0);
+
+    void flush();
+
+private:
+    void maybe_flush() {
+        if (_file && _buffer.size() >= (1ul << 20)) {
+            flush();
+        }
+    }
+
+    std::string _owned;
+    std::string& _buffer;
+    std::FILE* _file = nullptr;
+};
+
+struct generator_t {
+    int day = 0;
+    uint64_t default_size = 0;
+    // the scale the benchmark targets; inputs this large are only ever written to files or pipes
+    uint64_t large_size = 0;
+    const char* size_unit = "";
+    void (*generate)(uint64_t size, rng_t& rng, writer_t& out) = nullptr;
+};
+
+const std::map<int, generator_t>& generators();
+const generator_t* find_generator(int day);
+
+} // namespace bench
+} // namespace advent
@@ -1,94 +1,282 @@
-#include <algorithm>
-#include <fstream>
-#include <iostream>
-#include <iterator>
-#include <string>
-#include <vector>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
 #include <cassert>
 
-int part1_parse(const std::string& s) {
-    auto first_itr = std::find_if(s.cbegin(), s.cend(), [](const char& c) {
-        return c >= '0' && c <= '9';
-    });
-    auto last_itr = std::find_if(s.crbegin(), s.crend(), [](const char& c) {
-        return c >= '0' && c <= '9';
-    });
-    if (first_itr != s.cend()) {
-        assert(last_itr != s.crend());
-        return (*first_itr - '0') * 10 + (*last_itr - '0');
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <common/line_reader.h>
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/parallel.h>
+#include <common/runner.h>
+
+namespace day1 {
+
+constexpr std::array<std::string_view, 10> digit_names = {
+    "zero",
+    "one",
+    "two",
+    "three",
+    "four",
+    "five",
+    "six",
+    "seven",
+    "eight",
+    "nine",
+};
+
+constexpr bool is_digit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10u;
+}
+
+// Bytes a scan is looking for: every digit plus a few letters. The letters are also kept as a list so the
+// SIMD prefilter can compare a whole block against each of them.
+struct byte_set_t {
+    constexpr byte_set_t() {
+        for (char c = '0'; c <= '9'; c++) {
+            contains[static_cast<unsigned char>(c)] = true;
+        }
+    }
+
+    constexpr void add_letter(char c) {
+        if (!contains[static_cast<unsigned char>(c)]) {
+            contains[static_cast<unsigned char>(c)] = true;
+            letters[num_letters++] = c;
+        }
+    }
+
+    std::array<bool, 256> contains{};
+    std::array<char, 26> letters{};
+    size_t num_letters = 0ul;
+};
+
+// Aho-Corasick automaton over the digit names, built at compile time. The reverse automaton is built over
+// the reversed names and is stepped from the end of a line towards its start. Digits are single characters
+// and are checked before stepping, so the automaton only needs the lowercase letters plus one class for
+// every other byte, which sends it back to the root.
+template <bool Reverse>
+struct automaton_t {
+    static constexpr size_t max_states = 64ul;
+    static constexpr size_t num_classes = 27ul;
+
+    static constexpr size_t char_class(char c) {
+        auto letter = static_cast<unsigned char>(c - 'a');
+        return letter < 26u ? letter : 26ul;
+    }
+
+    constexpr automaton_t() {
+        std::array<uint8_t, max_states> fail{};
+        for (auto& m : match) {
+            m = -1;
+        }
+
+        // trie of the (possibly reversed) names; 0 doubles as "no child" since nothing points at the root
+        for (size_t d = 0ul; d < digit_names.size(); d++) {
+            auto name = digit_names[d];
+            size_t state = 0ul;
+            for (size_t k = 0ul; k < name.size(); k++) {
+                auto c = char_class(name[Reverse ? name.size() - 1ul - k : k]);
+                if (next[state][c] == 0) {
+                    next[state][c] = static_cast<uint8_t>(num_states++);
+                }
+                state = next[state][c];
+            }
+            match[state] = static_cast<int8_t>(d);
+            starts.add_letter(name[Reverse ? name.size() - 1ul : 0ul]);
+        }
+
+        // breadth first over the trie, turning missing children into the transitions of the failure state
+        std::array<uint8_t, max_states> queue{};
+        size_t head = 0ul, tail = 0ul;
+        for (size_t c = 0ul; c < num_classes; c++) {
+            if (next[0][c] != 0) {
+                queue[tail++] = next[0][c];
+            }
+        }
+        while (head < tail) {
+            auto state = queue[head++];
+            if (match[state] < 0) {
+                match[state] = match[fail[state]];
+            }
+            for (size_t c = 0ul; c < num_classes; c++) {
+                if (auto child = next[state][c]; child != 0) {
+                    fail[child] = next[fail[state]][c];
+                    queue[tail++] = child;
+                } else {
+                    next[state][c] = next[fail[state]][c];
+                }
+            }
+        }
+    }
+
+    std::array<std::array<uint8_t, num_classes>, max_states> next{};
+    // digit recognized on entering each state, or -1
+    std::array<int8_t, max_states> match{};
+    // bytes that can move the automaton out of the root state
+    byte_set_t starts;
+    size_t num_states = 1ul;
+};
+
+constexpr automaton_t<false> forward_automaton;
+constexpr automaton_t<true> reverse_automaton;
+constexpr byte_set_t digits_only;
+
+#if defined(__SSE2__)
+inline __m128i block_mask(__m128i block, const byte_set_t& set) {
+    // unsigned c - '0' < 10, done as a signed compare after flipping the sign bits
+    auto digits = _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(block, _mm_set1_epi8('0')), _mm_set1_epi8(-128)),
+                                 _mm_set1_epi8(10 - 128));
+    for (size_t i = 0ul; i < set.num_letters; i++) {
+        digits = _mm_or_si128(digits, _mm_cmpeq_epi8(block, _mm_set1_epi8(set.letters[i])));
     }
-    return 0;
+    return digits;
 }
+#endif
 
-int part2_parse(const std::string& s) {
-    static std::vector<std::string> string_digits{
-        "zero",
-        "one",
-        "two",
-        "three",
-        "four",
-        "five",
-        "six",
-        "seven",
-        "eight",
-        "nine",
-    };
-
-    auto first_numeric_itr = std::find_if(s.cbegin(), s.cend(), [](const char& c) {
-        return c >= '0' && c <= '9';
-    });
-    auto last_numeric_itr = std::find_if(s.crbegin(), s.crend(), [](const char& c) {
-        return c >= '0' && c <= '9';
-    });
+// Position of the first byte of `set` in [i, s.size()), or s.size().
+size_t skip_forward(std::string_view s, size_t i, const byte_set_t& set) {
+#if defined(__SSE2__)
+    for (; i + 16ul <= s.size(); i += 16ul) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+        if (auto mask = _mm_movemask_epi8(block_mask(block, set)); mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < s.size() && !set.contains[static_cast<unsigned char>(s[i])]) {
+        i++;
+    }
+    return i;
+}
+
+// One past the position of the last byte of `set` in [0, end), or 0.
+size_t skip_backward(std::string_view s, size_t end, const byte_set_t& set) {
+#if defined(__SSE2__)
+    for (; end >= 16ul; end -= 16ul) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + end - 16ul));
+        if (auto mask = _mm_movemask_epi8(block_mask(block, set)); mask != 0) {
+            return end - 16ul + (32 - __builtin_clz(mask));
+        }
+    }
+#endif
+    while (end > 0ul && !set.contains[static_cast<unsigned char>(s[end - 1ul])]) {
+        end--;
+    }
+    return end;
+}
 
-    int first_num = first_numeric_itr != s.cend() ? *first_numeric_itr - '0' : -1;
-    int last_num = last_numeric_itr != s.crend() ? *last_numeric_itr - '0' : -1;
+// The first and last digit of a line, once counting only digits (part 1) and once also counting digit
+// names (part 2); -1 when there is none.
+struct calibration_t {
+    int first_digit = -1;
+    int last_digit = -1;
+    int first_any = -1;
+    int last_any = -1;
 
-    auto first_pos = std::distance(s.cbegin(), first_numeric_itr);
-    auto last_pos = s.size() - std::distance(s.crbegin(), last_numeric_itr) - 1;
+    int part1() const { return first_digit >= 0 ? first_digit * 10 + last_digit : 0; }
+    int part2() const { return first_any >= 0 ? first_any * 10 + last_any : 0; }
+};
 
-    for (int i = 0; i < string_digits.size(); i++) {
-        auto first_string_pos = s.find(string_digits[i]);
-        if (first_string_pos < first_pos) {
-            first_pos = first_string_pos;
-            first_num = i;
+void scan_front(std::string_view s, calibration_t& calibration) {
+    const auto& automaton = forward_automaton;
+    uint8_t state = 0;
+    for (size_t i = 0ul; ; i++) {
+        if (state == 0) {
+            i = skip_forward(s, i, automaton.starts);
+        }
+        if (i == s.size()) {
+            return;
+        }
+        if (is_digit(s[i])) {
+            calibration.first_digit = calibration.first_any = s[i] - '0';
+            return;
+        }
+        state = automaton.next[state][automaton.char_class(s[i])];
+        if (automaton.match[state] >= 0) {
+            // a name came first; part 1 still needs the first real digit
+            calibration.first_any = automaton.match[state];
+            if (auto d = skip_forward(s, i + 1ul, digits_only); d != s.size()) {
+                calibration.first_digit = s[d] - '0';
+            }
+            return;
         }
+    }
+}
 
-        auto last_string_pos = s.rfind(string_digits[i]);
-        if (last_string_pos < s.size() && last_string_pos > last_pos) {
-            last_pos = last_string_pos;
-            last_num = i;
+void scan_back(std::string_view s, calibration_t& calibration) {
+    const auto& automaton = reverse_automaton;
+    uint8_t state = 0;
+    for (size_t end = s.size(); ; end--) {
+        if (state == 0) {
+            end = skip_backward(s, end, automaton.starts);
+        }
+        if (end == 0ul) {
+            return;
+        }
+        auto c = s[end - 1ul];
+        if (is_digit(c)) {
+            calibration.last_digit = calibration.last_any = c - '0';
+            return;
+        }
+        state = automaton.next[state][automaton.char_class(c)];
+        if (automaton.match[state] >= 0) {
+            calibration.last_any = automaton.match[state];
+            if (auto d = skip_backward(s, end - 1ul, digits_only); d != 0ul) {
+                calibration.last_digit = s[d - 1ul] - '0';
+            }
+            return;
         }
     }
+}
 
-    if (first_num >= 0) {
-        assert(last_num >= 0);
-        return first_num * 10 + last_num;
+// Both parts' values for a line from one scan from each end.
+calibration_t scan_line(std::string_view s) {
+    ADVENT_METRICS_COUNT("day1.lines", 1);
+    calibration_t calibration;
+    scan_front(s, calibration);
+    if (calibration.first_any >= 0) {
+        scan_back(s, calibration);
     }
+    assert((calibration.first_digit >= 0) == (calibration.last_digit >= 0));
+    assert((calibration.first_any >= 0) == (calibration.last_any >= 0));
+    return calibration;
+}
 
-    return 0;
+using sums_t = std::pair<uint64_t, uint64_t>;
+
+uint64_t part1(const sums_t& sums) {
+    return sums.first;
+}
+
+uint64_t part2(const sums_t& sums) {
+    return sums.second;
 }
 
-void run_solution() {
-    int part1_sum = 0;
-    int part2_sum = 0;
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day1/input.txt");
-    if (input_file.is_open()) {
-        while (std::getline(input_file, line)) {
-            part1_sum += part1_parse(line);
-            part2_sum += part2_parse(line);
-        }
-        input_file.close();
-
-        std::cout << "Part 1: " << part1_sum << std::endl;
-        std::cout << "Part 2: " << part2_sum << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+sums_t solve_stream(advent::io::line_reader_t& lines) {
+    sums_t sums{0, 0};
+    for (std::string_view line; lines.next(line);) {
+        auto calibration = scan_line(line);
+        sums.first += calibration.part1();
+        sums.second += calibration.part2();
     }
+    return sums;
 }
 
-int main() {
-    run_solution();
-    return 0;
+// Both parts are summed in the one pass over the input.
+sums_t parse(std::string_view input) {
+    return advent::parallel::parallel_line_reduce(input, sums_t{0, 0}, [](std::string_view line) {
+        auto calibration = scan_line(line);
+        return sums_t{calibration.part1(), calibration.part2()};
+    }, [](const sums_t& l, const sums_t& r) {
+        return sums_t{l.first + r.first, l.second + r.second};
+    });
 }
+
+} // namespace day1
+
+ADVENT_REGISTER_DAY(1, day1::parse, day1::part1, day1::part2);
+ADVENT_REGISTER_STREAM(1, day1::solve_stream);
@@ -0,0 +1,185 @@
+#include "game_store.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include <cassert>
+
+#include <common/input_error.h>
+#include <common/metrics.h>
+#include <common/numbers.h>
+#include <common/parallel.h>
+
+namespace day2 {
+
+namespace {
+
+// Kept out of line so the error path does not weigh on the parser's hot loop.
+[[noreturn]] __attribute__((noinline, cold)) void malformed(std::string_view line) {
+    throw advent::io::input_error_t("expected \"Game <id>: <count> <color>, ...\"", line);
+}
+
+} // namespace
+
+// Single pass over a "Game <id>: <count> <color>, ...; ..." line. Round boundaries do not matter for the
+// maxima, so ',' and ';' are treated alike, and the color is told apart by its first letter.
+bool parse_line(std::string_view line, game_max_t& game) {
+    // a blank line, typically the last one, holds no game
+    if (line.empty()) {
+        return false;
+    }
+    auto p = line.data();
+    auto end = p + line.size();
+    if (line.size() <= 5ul || line.substr(0, 5) != "Game ") {
+        malformed(line);
+    }
+
+    // a game has a non-negative id and at least one draw
+    auto id_res = advent::numbers::parse<int>(p + 5, end);
+    if (!id_res || id_res.value < 0 || id_res.ptr == end || *id_res.ptr != ':' || id_res.ptr + 1 == end) {
+        malformed(line);
+    }
+    game.id = id_res.value;
+
+    // The colors are told apart by their first letter through a small table indexed by its low five bits,
+    // and counts of one or two digits are read without branching, so random colors and counts do not
+    // cost a branch miss each. Only the reads are bounds-checked as they go; the format checks are folded
+    // into `valid`, tested once per line.
+    struct color_t {
+        char letter;
+        uint8_t index;
+        uint8_t length;
+    };
+    static constexpr auto colors = [] {
+        std::array<color_t, 32> colors{};
+        colors['r' & 31] = {'r', 0, 3};
+        colors['g' & 31] = {'g', 1, 5};
+        colors['b' & 31] = {'b', 2, 4};
+        return colors;
+    }();
+    auto is_digit = [](char c) { return static_cast<unsigned char>(c - '0') < 10u; };
+
+    std::array<int, 3> max_counts{0, 0, 0};
+    bool valid = true;
+    p = id_res.ptr + 1;
+    while (p < end) {
+        // the shortest draw is " <digit> <letter>"
+        if (end - p < 4) {
+            malformed(line);
+        }
+        valid &= *p == ' ' && is_digit(p[1]);
+        p++;
+        int count = p[0] - '0';
+        bool two_digits = p[1] != ' ';
+        valid &= !two_digits || is_digit(p[1]);
+        count = two_digits ? count * 10 + (p[1] - '0') : count;
+        p += 1 + two_digits;
+        // longer counts are rare, so they are checked as they are read; nine digits always fit in an int
+        for (; p < end && *p != ' '; p++) {
+            if (!is_digit(*p) || static_cast<unsigned>(count) >= 100000000u) {
+                malformed(line);
+            }
+            count = count * 10 + (*p - '0');
+        }
+
+        // skip the space, then the color name and the ',' or ';' after it
+        p++;
+        if (p >= end) {
+            malformed(line);
+        }
+        auto color = colors[*p & 31];
+        if (end - p < color.length) {
+            malformed(line);
+        }
+        valid &= color.letter == *p;
+        max_counts[color.index] = std::max(max_counts[color.index], count);
+        p += color.length;
+        valid &= p == end || *p == ',' || *p == ';';
+        p += p < end;
+    }
+    if (!valid) {
+        malformed(line);
+    }
+    game.max_dice = {max_counts[0], max_counts[1], max_counts[2]};
+    return true;
+}
+
+game_store_t game_store_t::parse(std::string_view input) {
+    auto stores = advent::parallel::parallel_map_chunks(input, [](std::string_view chunk) {
+        game_store_t store;
+        game_max_t game;
+        for (auto line : advent::io::lines_t(chunk)) {
+            if (!parse_line(line, game)) {
+                continue;
+            }
+            store.add(game);
+            ADVENT_METRICS_COUNT("day2.games", 1);
+        }
+        return store;
+    });
+    if (stores.empty()) {
+        return {};
+    }
+    for (size_t i = 1ul; i < stores.size(); i++) {
+        stores.front().append(stores[i]);
+    }
+    return std::move(stores.front());
+}
+
+void game_store_t::add(const game_max_t& game) {
+    assert(game.id >= 0);
+    _ids.push_back(static_cast<uint32_t>(game.id));
+    _red.push_back(static_cast<uint32_t>(game.max_dice.red));
+    _green.push_back(static_cast<uint32_t>(game.max_dice.green));
+    _blue.push_back(static_cast<uint32_t>(game.max_dice.blue));
+}
+
+void game_store_t::append(const game_store_t& other) {
+    _ids.insert(_ids.end(), other._ids.cbegin(), other._ids.cend());
+    _red.insert(_red.end(), other._red.cbegin(), other._red.cend());
+    _green.insert(_green.end(), other._green.cbegin(), other._green.cend());
+    _blue.insert(_blue.end(), other._blue.cbegin(), other._blue.cend());
+}
+
+void game_store_t::sum_possible(const dice_t* bags, size_t num_bags, uint64_t* sums) const {
+    // 4 columns x 2048 games x 4 bytes stays within L1
+    constexpr size_t block_size = 2048ul;
+
+    std::fill(sums, sums + num_bags, 0ull);
+    const uint32_t* ids = _ids.data();
+    const uint32_t* red = _red.data();
+    const uint32_t* green = _green.data();
+    const uint32_t* blue = _blue.data();
+    for (size_t begin = 0ul; begin < size(); begin += block_size) {
+        auto end = std::min(begin + block_size, size());
+        for (size_t q = 0ul; q < num_bags; q++) {
+            auto max_red = static_cast<uint32_t>(bags[q].red);
+            auto max_green = static_cast<uint32_t>(bags[q].green);
+            auto max_blue = static_cast<uint32_t>(bags[q].blue);
+            // branch-free compare and masked add; the compiler turns this loop into vector compares
+            uint64_t sum = 0ull;
+            for (size_t i = begin; i < end; i++) {
+                uint32_t possible = (red[i] <= max_red) & (green[i] <= max_green) & (blue[i] <= max_blue);
+                sum += ids[i] & (0u - possible);
+            }
+            sums[q] += sum;
+        }
+    }
+}
+
+uint64_t game_store_t::sum_possible(const dice_t& bag) const {
+    uint64_t sum = 0ull;
+    sum_possible(&bag, 1ul, &sum);
+    return sum;
+}
+
+uint64_t game_store_t::sum_power() const {
+    uint64_t sum = 0ull;
+    for (size_t i = 0ul; i < size(); i++) {
+        sum += static_cast<uint64_t>(_red[i]) * _green[i] * _blue[i];
+    }
+    return sum;
+}
+
+} // namespace day2
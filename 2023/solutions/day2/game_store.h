@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace day2 {
+
+struct dice_t {
+    int red = 0;
+    int green = 0;
+    int blue = 0;
+};
+
+// Everything either part needs from a game: its id and the largest count of each color over all rounds.
+struct game_max_t {
+    int id = -1;
+    dice_t max_dice;
+};
+
+// Reads one game into `game`; returns false for a blank line and throws io::input_error_t for a malformed one.
+bool parse_line(std::string_view line, game_max_t& game);
+
+// Column-oriented store of parsed games: one contiguous array per field, so a query only streams the
+// columns it compares and the kernels vectorize.
+class game_store_t {
+public:
+    // Parses every game of `input`, in parallel across line chunks.
+    static game_store_t parse(std::string_view input);
+
+    void add(const game_max_t& game);
+    void append(const game_store_t& other);
+
+    size_t size() const { return _ids.size(); }
+
+    // Sum of the ids of the games possible with each of `bags`, written to `sums`. The batch is answered
+    // over cache-sized blocks of games, so each block is read from memory once per batch rather than once
+    // per query.
+    void sum_possible(const dice_t* bags, size_t num_bags, uint64_t* sums) const;
+    uint64_t sum_possible(const dice_t& bag) const;
+
+    // Sum over all games of the product of the per-color maxima.
+    uint64_t sum_power() const;
+
+private:
+    std::vector<uint32_t> _ids;
+    std::vector<uint32_t> _red;
+    std::vector<uint32_t> _green;
+    std::vector<uint32_t> _blue;
+};
+
+} // namespace day2
@@ -1,113 +1,57 @@
-#include <algorithm>
-#include <fstream>
-#include <iostream>
-#include <string>
-#include <sstream>
-#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <utility>
 
-#include <cassert>
+#include <common/line_reader.h>
+#include <common/metrics.h>
+#include <common/runner.h>
 
-#include <common/strings.h>
+#include "game_store.h"
 
+namespace day2 {
 
-struct dice_t {
-    int red = 0;
-    int green = 0;
-    int blue = 0;
-};
+// the bag part 1 asks about
+constexpr dice_t target_dice = {12, 13, 14};
 
-struct game_t {
-    int id = -1;
-    std::vector<dice_t> dice_rounds;
-};
-
-game_t parse_line(const std::string& line) {
-    auto game_split = advent::strings::split(line, ':');
-    assert(game_split.size() == 2ul);
-    assert(game_split.front().size() > 5);
-
-    game_t game;
-    game.id = std::stoi(game_split.front().substr(5));
-
-    auto rounds_split = advent::strings::split(game_split[1], ';');
-    assert(!rounds_split.empty());
-    for (const auto& round : rounds_split) {
-        auto dice_split = advent::strings::split(round, ',');
-        assert(!dice_split.empty());
-        game.dice_rounds.emplace_back();
-
-        for (auto& d : dice_split) {
-            d.erase(d.begin(), std::find_if(d.begin(), d.end(), [](unsigned char ch) {
-                return !std::isspace(ch);
-            }));
-            auto num_split = advent::strings::split(d, ' ');
-            assert(num_split.size() == 2ul);
-
-            if (num_split[1].find("red") != std::string::npos) {
-                game.dice_rounds.back().red = std::stoi(num_split.front());
-            } else if (num_split[1].find("green") != std::string::npos) {
-                game.dice_rounds.back().green = std::stoi(num_split.front());
-            } else if (num_split[1].find("blue") != std::string::npos) {
-                game.dice_rounds.back().blue = std::stoi(num_split.front());
-            } else {
-                assert(false);
-            }
-        }
+int part1_parse(const game_max_t& game) {
+    if (game.max_dice.red > target_dice.red || game.max_dice.green > target_dice.green
+        || game.max_dice.blue > target_dice.blue) {
+        return 0;
     }
-
-    return game;
+    return game.id;
 }
 
-int part1_parse(const game_t& game) {
-    constexpr dice_t target_dice = {12, 13, 14};
-
-    for (const auto& round : game.dice_rounds) {
-        if (round.red > target_dice.red || round.green > target_dice.green || round.blue > target_dice.blue) {
-            return 0;
-        }
-    }
-
-    return game.id;
+int part2_parse(const game_max_t& game) {
+    return game.max_dice.red * game.max_dice.green * game.max_dice.blue;
 }
 
-int part2_parse(const game_t& game) {
-    assert(!game.dice_rounds.empty());
-    dice_t min_dice_set = {
-        std::max_element(game.dice_rounds.cbegin(), game.dice_rounds.cend(), [](const dice_t& l, const dice_t& r) {
-            return l.red < r.red;
-        })->red,
-        std::max_element(game.dice_rounds.cbegin(), game.dice_rounds.cend(), [](const dice_t& l, const dice_t& r) {
-            return l.green < r.green;
-        })->green,
-        std::max_element(game.dice_rounds.cbegin(), game.dice_rounds.cend(), [](const dice_t& l, const dice_t& r) {
-            return l.blue < r.blue;
-        })->blue,
-    };
+uint64_t part1(const game_store_t& games) {
+    return games.sum_possible(target_dice);
+}
 
-    return min_dice_set.red * min_dice_set.green * min_dice_set.blue;
+uint64_t part2(const game_store_t& games) {
+    return games.sum_power();
 }
 
-void run_solution() {
-    int part1_sum = 0;
-    int part2_sum = 0;
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day2/input.txt");
-    if (input_file.is_open()) {
-        while (std::getline(input_file, line)) {
-            auto game = parse_line(line);
-            part1_sum += part1_parse(game);
-            part2_sum += part2_parse(game);
+std::pair<uint64_t, uint64_t> solve_stream(advent::io::line_reader_t& lines) {
+    std::pair<uint64_t, uint64_t> sums{0, 0};
+    game_max_t game;
+    for (std::string_view line; lines.next(line);) {
+        if (!parse_line(line, game)) {
+            continue;
         }
-        input_file.close();
-
-        std::cout << "Part 1: " << part1_sum << std::endl;
-        std::cout << "Part 2: " << part2_sum << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+        ADVENT_METRICS_COUNT("day2.games", 1);
+        sums.first += part1_parse(game);
+        sums.second += part2_parse(game);
     }
+    return sums;
 }
 
-int main() {
-    run_solution();
-    return 0;
+game_store_t parse(std::string_view input) {
+    return game_store_t::parse(input);
 }
+
+} // namespace day2
+
+ADVENT_REGISTER_DAY(2, day2::parse, day2::part1, day2::part2);
+ADVENT_REGISTER_STREAM(2, day2::solve_stream);
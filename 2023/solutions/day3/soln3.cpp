@@ -1,189 +1,326 @@
 #include <algorithm>
-#include <fstream>
-#include <iostream>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <cassert>
 
-using grid_t = std::vector<std::string>;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-class grid_data_t {
-public:
-    grid_data_t(grid_t&& grid) : _grid(std::move(grid)), _visited() {
-        assert(!_grid.empty());
-        assert(!_grid.front().empty());
+#include <common/grid.h>
+#include <common/input_error.h>
+#include <common/line_reader.h>
+#include <common/metrics.h>
+#include <common/parallel.h>
+#include <common/runner.h>
 
-        for (size_t i = 0ul; i < num_rows(); i++) {
-            _visited.push_back(std::vector<bool>(num_columns(), false));
-        }
-    }
+namespace day3 {
 
-    const grid_t& grid() const { return _grid; }
-    size_t num_rows() const { return _grid.size(); }
-    size_t last_row() const { return num_rows() - 1ul; }
-    size_t num_columns() const { return _grid.front().size(); }
-    size_t last_column() const { return num_columns() - 1ul; }
+using grid_t = advent::grid::padded_grid_t<char>;
+using labels_t = advent::grid::padded_grid_t<uint16_t>;
 
-    bool has_visited(size_t i, size_t j) const { return _visited[i][j]; }
-    void visit(size_t i, size_t j) { _visited[i][j] = true; }
-
-private:
-    grid_t _grid;
-    std::vector<std::vector<bool>> _visited;
-};
-
-bool is_digit_left(const grid_data_t& data, size_t i, size_t j) {
-    return j > 0ul && std::isdigit(data.grid()[i][j - 1]);
+bool is_digit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10u;
 }
 
-bool is_digit_right(const grid_data_t& data, size_t i, size_t j) {
-    return j < data.last_column() && std::isdigit(data.grid()[i][j + 1]);
-};
+bool is_symbol(char c) {
+    return c != '.' && !is_digit(c);
+}
 
-int parse_number(grid_data_t& data, size_t i, size_t j, bool mark_visited) {
-    // For Part 1, it's quite clear that we need to be sure not to double count numbers we find
-    // as we are searching based on adjacent digits to symbols (we could find the same digit from different symbols).
-    // For Part 2, it's not clear or specified what to do if there is a shared number around 2 '*'s.
-    // The input data does not appear to have this situation; so, not worrying about it *shrug*
-    if (mark_visited && data.has_visited(i, j)) return 0;
-    auto left_j = j;
-    while(is_digit_left(data, i, left_j)) {
-        left_j--;
+// Position of the first digit (or symbol) in [i, end) of `row`, or `end`. Most cells are '.', so 16 cells
+// are classified at a time with SSE2 where available.
+template <bool Symbols>
+size_t find_next(const char* row, size_t i, size_t end) {
+#if defined(__SSE2__)
+    for (; i + 16ul <= end; i += 16ul) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        // unsigned c - '0' < 10, done as a signed compare after flipping the sign bits
+        auto digits = _mm_cmplt_epi8(_mm_xor_si128(_mm_sub_epi8(block, _mm_set1_epi8('0')), _mm_set1_epi8(-128)),
+                                     _mm_set1_epi8(10 - 128));
+        int mask = _mm_movemask_epi8(digits);
+        if constexpr (Symbols) {
+            mask = ~(mask | _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('.')))) & 0xffff;
+        }
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    while (i < end && !(Symbols ? is_symbol(row[i]) : is_digit(row[i]))) {
+        i++;
     }
+    return i;
+}
+
+// The schematic plus a label per cell: the digit runs of each row are numbered from 1 up, the number is
+// stored in each cell of the run (0 elsewhere, including the border), and the run's value is at
+// values[row_first[row + 1] + label]. Labels are row-local so they fit in 16 bits, halving the label map.
+// With the labels, finding the numbers around a symbol is eight loads, and each number is parsed once.
+struct schematic_t {
+    static constexpr size_t max_columns = 2ul * std::numeric_limits<uint16_t>::max() - 1ul;
 
-    auto right_j = j;
-    while(is_digit_right(data, i, right_j)) {
-        right_j++;
+    // Throws io::input_error_t for an empty grid or one too wide to label.
+    explicit schematic_t(std::string_view input)
+        : grid(grid_t::from_lines(input, '.')), labels(grid.rows(), grid.columns(), 0u),
+          neighbors(grid.offsets(advent::grid::neighbors8)), row_first(grid.rows() + 2ul, 0u), values(1ul, 0u) {
+        if (grid.rows() == 0ul) {
+            throw advent::io::input_error_t("expected at least one grid row");
+        }
+        // a row holds at most (columns + 1) / 2 runs, and each needs a label of its own
+        if (grid.columns() > max_columns) {
+            throw advent::io::input_error_t("grid rows are wider than the " + std::to_string(max_columns)
+                                            + " columns the 16-bit labels can number");
+        }
+        const char* cells = grid.data();
+        uint16_t* cell_labels = labels.data();
+        for (size_t i = 0ul; i < grid.rows(); i++) {
+            row_first[i + 1ul] = static_cast<uint32_t>(values.size() - 1ul);
+            uint16_t label = 0u;
+            auto row_end = grid.index(i, 0) + grid.columns();
+            for (auto cell = find_next<false>(cells, grid.index(i, 0), row_end); cell < row_end;
+                 cell = find_next<false>(cells, cell, row_end)) {
+                // the border stops the run at the end of the row
+                label++;
+                uint32_t value = 0u;
+                for (; is_digit(cells[cell]); cell++) {
+                    value = value * 10u + static_cast<uint32_t>(cells[cell] - '0');
+                    cell_labels[cell] = label;
+                }
+                values.push_back(value);
+            }
+        }
+        ADVENT_METRICS_COUNT("day3.numbers", values.size() - 1ul);
     }
 
-    if (mark_visited) {
-        for (auto k = left_j; k <= right_j; k++) {
-            data.visit(i, k);
+    // Ids (indices into `values`) of the distinct numbers around the symbol at (`row`, `cell`), written to
+    // `ids`; returns how many. A run never spans two rows, and within a row the same label can only repeat
+    // in neighboring cells.
+    size_t adjacent_numbers(size_t row, size_t cell, std::array<uint32_t, 8>& ids) const {
+        size_t count = 0ul;
+        uint16_t previous = 0u;
+        for (size_t n = 0ul; n < neighbors.size(); n++) {
+            const auto& offset = advent::grid::neighbors8[n];
+            auto label = labels[cell + neighbors[n]];
+            if (offset.column == -1) {
+                previous = 0u;
+            }
+            if (label != 0u && label != previous) {
+                ids[count++] = row_first[row + 1ul + offset.row] + label;
+            }
+            previous = label;
         }
+        return count;
     }
 
-    return std::stoi(data.grid()[i].substr(left_j, right_j)); 
-}
+    grid_t grid;
+    labels_t labels;
+    std::array<ptrdiff_t, 8> neighbors;
+    // id of the first run of each row, less one, indexed by row + 1 so the border rows are included
+    std::vector<uint32_t> row_first;
+    std::vector<uint32_t> values;
+};
 
-int part1(grid_data_t& data) {
-    auto sum_neighbors = [&data](auto i, auto j) {
-        int s = 0;
-        if (is_digit_left(data, i, j)) {
-            s += parse_number(data, i, j - 1, true);
-        }
-        if (is_digit_right(data, i, j)) {
-            s += parse_number(data, i, j + 1, true);
-        }
-        return s;
-    };
-
-    int sum = 0;
-
-    for (size_t i = 0ul; i < data.num_rows(); i++) {
-        for (size_t j = 0ul; j < data.num_columns(); j++) {
-            if (data.grid()[i][j] != '.' && !std::isdigit(data.grid()[i][j])) {
-                // above
-                if (i > 0ul) {
-                    if (std::isdigit(data.grid()[i - 1][j])) {
-                        sum += parse_number(data, i - 1, j, true);
-                    } else {
-                        sum += sum_neighbors(i - 1, j);
-                    }
-                }
+// Row bands smaller than this are not worth a thread.
+constexpr size_t min_band_rows = 256ul;
 
-                sum += sum_neighbors(i, j);
+uint64_t part1(const schematic_t& schematic) {
+    // a number next to several symbols is flagged by each of them but summed once
+    std::unique_ptr<std::atomic<bool>[]> adjacent(new std::atomic<bool>[schematic.values.size()]);
+    for (size_t id = 0ul; id < schematic.values.size(); id++) {
+        adjacent[id].store(false, std::memory_order_relaxed);
+    }
 
-                // below
-                if (i < data.last_row()) {
-                    if (std::isdigit(data.grid()[i + 1][j])) {
-                        sum += parse_number(data, i + 1, j, true);
-                    } else {
-                        sum += sum_neighbors(i + 1, j);
-                    }
+    const auto& grid = schematic.grid;
+    advent::parallel::parallel_map_range(grid.rows(), min_band_rows, [&](size_t first_row, size_t last_row) {
+        const char* cells = grid.data();
+        std::array<uint32_t, 8> ids;
+        for (size_t i = first_row; i < last_row; i++) {
+            auto row_end = grid.index(i, 0) + grid.columns();
+            for (auto cell = find_next<true>(cells, grid.index(i, 0), row_end); cell < row_end;
+                 cell = find_next<true>(cells, cell + 1ul, row_end)) {
+                auto count = schematic.adjacent_numbers(i, cell, ids);
+                for (size_t k = 0ul; k < count; k++) {
+                    adjacent[ids[k]].store(true, std::memory_order_relaxed);
                 }
-
             }
         }
-    }
+        return 0;
+    });
 
+    uint64_t sum = 0;
+    for (size_t id = 1ul; id < schematic.values.size(); id++) {
+        if (adjacent[id].load(std::memory_order_relaxed)) {
+            sum += schematic.values[id];
+        }
+    }
     return sum;
 }
 
-int part2(grid_data_t& data) {
-    auto check_neighbors = [&data](auto i, auto j, int& count) {
-        int p = 1;
-        if (is_digit_left(data, i, j)) {
-            p *= parse_number(data, i, j - 1, false);
-            count++;
-        }
-        if (is_digit_right(data, i, j)) {
-            p *= parse_number(data, i, j + 1, false);
-            count++;
-        }
-        return p;
-    };
-
-    int sum = 0;
-
-    for (size_t i = 0ul; i < data.num_rows(); i++) {
-        for (size_t j = 0ul; j < data.num_columns(); j++) {
-            if (data.grid()[i][j] == '*') {
-                int gear_ratio = 1;
-                int adjacent_count = 0;
-
-                // above
-                if (i > 0ul) {
-                    if (std::isdigit(data.grid()[i - 1][j])) {
-                        gear_ratio *= parse_number(data, i - 1, j, false);
-                        adjacent_count++;
-                    } else {
-                        gear_ratio *= check_neighbors(i - 1, j, adjacent_count);
-                    }
+uint64_t part2(const schematic_t& schematic) {
+    const auto& grid = schematic.grid;
+    auto sums = advent::parallel::parallel_map_range(grid.rows(), min_band_rows, [&](size_t first_row, size_t last_row) {
+        uint64_t sum = 0;
+        std::array<uint32_t, 8> ids;
+        for (size_t i = first_row; i < last_row; i++) {
+            auto row = grid.data() + grid.index(i, 0);
+            auto row_end = row + grid.columns();
+            for (auto p = static_cast<const char*>(std::memchr(row, '*', row_end - row)); p != nullptr;
+                 p = static_cast<const char*>(std::memchr(p + 1, '*', row_end - p - 1))) {
+                if (schematic.adjacent_numbers(i, p - grid.data(), ids) == 2ul) {
+                    sum += static_cast<uint64_t>(schematic.values[ids[0]]) * schematic.values[ids[1]];
                 }
+            }
+        }
+        return sum;
+    });
+
+    uint64_t sum = 0;
+    for (auto s : sums) {
+        sum += s;
+    }
+    return sum;
+}
+
+// Streaming engine for schematics too large to hold: adjacency only reaches one row up and one row down, so
+// rows pass through a ring of three, each padded with '.' on both ends like the grid border. A row is
+// finished as soon as the row below it arrives; memory is O(row width) however tall the input is.
+class row_window_t {
+public:
+    // Takes the next row; like padded_grid_t::from_lines, blank lines may only trail the grid and every
+    // row must be as wide as the first, or io::input_error_t is thrown.
+    void push(std::string_view line) {
+        if (line.empty()) {
+            _ended = true;
+            return;
+        }
+        if (_ended) {
+            throw advent::io::input_error_t("unexpected blank line before grid row", line);
+        }
+        if (_rows_seen == 0ul) {
+            _width = line.size();
+            _blank.assign(_width + 2ul, '.');
+            _ring[2] = _blank;
+        }
+        if (line.size() != _width) {
+            throw advent::io::input_error_t("expected every grid row to be as wide as the first", line);
+        }
+        auto& row = _ring[_rows_seen % 3ul];
+        row.assign(1ul, '.');
+        row.append(line);
+        row.push_back('.');
+        // row r sits in slot r % 3; once row r is in, row r - 1 has both of its neighbors
+        if (_rows_seen++ > 0ul) {
+            finish_row(_ring[_rows_seen % 3ul], _ring[(_rows_seen + 1ul) % 3ul], row);
+        }
+    }
 
-                gear_ratio *= check_neighbors(i, j, adjacent_count);
+    // Finishes the last row, against a blank row below it.
+    void close() {
+        if (_rows_seen > 0ul) {
+            finish_row(_ring[(_rows_seen + 1ul) % 3ul], _ring[(_rows_seen + 2ul) % 3ul], _blank);
+        }
+    }
 
-                // below
-                if (i < data.last_row()) {
-                    if (std::isdigit(data.grid()[i + 1][j])) {
-                        gear_ratio *= parse_number(data, i + 1, j, false);
-                        adjacent_count++;
-                    } else {
-                        gear_ratio *= check_neighbors(i + 1, j, adjacent_count);
-                    }
-                }
+    uint64_t part1() const { return _part1; }
+    uint64_t part2() const { return _part2; }
 
-                if (adjacent_count == 2) {
-                    sum += gear_ratio;
-                }
-            }
+private:
+    // The whole number with a digit at `j`; rows are padded, so the scan stops inside the row.
+    static uint32_t number_at(const std::string& row, size_t j) {
+        while (is_digit(row[j - 1ul])) {
+            j--;
+        }
+        uint32_t value = 0u;
+        for (; is_digit(row[j]); j++) {
+            value = value * 10u + static_cast<uint32_t>(row[j] - '0');
         }
+        return value;
     }
 
-    return sum;
-}
+    void finish_row(const std::string& above, const std::string& row, const std::string& below) {
+        auto end = _width + 1ul;
 
-void run_solution() {
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day3/input.txt");
-    if (input_file.is_open()) {
-        grid_t grid;
-        while (std::getline(input_file, line)) {
-            grid.push_back(line);
+        // part 1: every number of this row with a symbol anywhere in the box around it
+        for (auto j = find_next<false>(row.data(), 1ul, end); j < end; j = find_next<false>(row.data(), j, end)) {
+            auto first = j;
+            uint32_t value = 0u;
+            for (; is_digit(row[j]); j++) {
+                value = value * 10u + static_cast<uint32_t>(row[j] - '0');
+            }
+            for (auto k = first - 1ul; k <= j; k++) {
+                if (is_symbol(above[k]) || is_symbol(row[k]) || is_symbol(below[k])) {
+                    _part1 += value;
+                    break;
+                }
+            }
+        }
+
+        // part 2: every '*' of this row with exactly two numbers around it
+        for (auto p = static_cast<const char*>(std::memchr(row.data() + 1, '*', _width)); p != nullptr;
+             p = static_cast<const char*>(std::memchr(p + 1, '*', row.data() + end - p - 1))) {
+            auto j = static_cast<size_t>(p - row.data());
+            uint64_t gear_ratio = 1;
+            int adjacent_count = 0;
+            auto add = [&](const std::string& r, size_t k) {
+                gear_ratio *= number_at(r, k);
+                adjacent_count++;
+            };
+            for (const auto* r : {&above, &below}) {
+                if (is_digit((*r)[j])) {
+                    add(*r, j);
+                } else {
+                    if (is_digit((*r)[j - 1ul])) {
+                        add(*r, j - 1ul);
+                    }
+                    if (is_digit((*r)[j + 1ul])) {
+                        add(*r, j + 1ul);
+                    }
+                }
+            }
+            if (is_digit(row[j - 1ul])) {
+                add(row, j - 1ul);
+            }
+            if (is_digit(row[j + 1ul])) {
+                add(row, j + 1ul);
+            }
+            if (adjacent_count == 2) {
+                _part2 += gear_ratio;
+            }
         }
-        input_file.close();
+    }
 
-        grid_data_t data(std::move(grid));
+    std::array<std::string, 3> _ring;
+    std::string _blank;
+    size_t _width = 0ul;
+    size_t _rows_seen = 0ul;
+    // a blank line was seen, so no row may follow
+    bool _ended = false;
+    uint64_t _part1 = 0;
+    uint64_t _part2 = 0;
+};
 
-        std::cout << "Part 1: " << part1(data) << std::endl;
-        std::cout << "Part 2: " << part2(data) << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+std::pair<uint64_t, uint64_t> solve_stream(advent::io::line_reader_t& lines) {
+    row_window_t window;
+    for (std::string_view line; lines.next(line);) {
+        window.push(line);
     }
+    window.close();
+    return {window.part1(), window.part2()};
 }
 
-int main() {
-    run_solution();
-    return 0;
+schematic_t parse(std::string_view input) {
+    return schematic_t(input);
 }
+
+} // namespace day3
+
+ADVENT_REGISTER_DAY(3, day3::parse, day3::part1, day3::part2);
+ADVENT_REGISTER_STREAM(3, day3::solve_stream);
\ No newline at end of file
@@ -1,108 +1,373 @@
 #include <algorithm>
-#include <cmath>
-#include <fstream>
-#include <iostream>
-#include <string>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <utility>
 #include <vector>
 
-#include <common/strings.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <common/input_error.h>
+#include <common/line_reader.h>
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/numbers.h>
+#include <common/parallel.h>
+#include <common/runner.h>
 
 #include <cassert>
 
+namespace day4 {
+
+// Card numbers are all below 128, so each side of a card is a 128-bit set and the match count of a card
+// is an AND plus a popcount.
+struct mask128_t {
+    uint64_t words[2] = {0ull, 0ull};
+
+    void set(uint32_t n) {
+        assert(n < 128u);
+        words[n >> 6] |= 1ull << (n & 63u);
+    }
+};
 
 struct card_t {
-    int id;
-    std::vector<int> winning_numbers;
-    std::vector<int> test_numbers;
+    mask128_t winning_numbers;
+    mask128_t test_numbers;
 };
 
+inline int popcount64(uint64_t v) {
+#if defined(__POPCNT__)
+    return __builtin_popcountll(v);
+#else
+    // without the popcnt instruction the builtin is a library call; the bit-slicing version inlines and
+    // vectorizes in count_matches
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<int>((v * 0x0101010101010101ull) >> 56);
+#endif
+}
+
 int num_matches(const card_t& card) {
-    int matches = 0;
-    for (auto num : card.test_numbers) {
-        matches += std::count(card.winning_numbers.cbegin(), card.winning_numbers.cend(), num);
+    return popcount64(card.winning_numbers.words[0] & card.test_numbers.words[0])
+        + popcount64(card.winning_numbers.words[1] & card.test_numbers.words[1]);
+}
+
+// Batched kernel: match counts of `n` cards into `matches`, as one flat loop over the card array.
+void count_matches(const card_t* cards, size_t n, uint8_t* matches) {
+    for (size_t i = 0ul; i < n; i++) {
+        matches[i] = static_cast<uint8_t>(num_matches(cards[i]));
     }
-    return matches;
 }
 
-int part1(const card_t& card) {
-    int matches = num_matches(card);
-    if (!matches) return 0;
-    return std::pow(2, matches - 1);
+// 2^(matches - 1) points. Like the sums they are added to, the points are kept modulo 2^64, which makes
+// them 0 from 65 matches on.
+uint64_t part1_card(int matches) {
+    assert(matches >= 0 && matches <= 128);
+    return matches > 0 && matches <= 64 ? 1ull << (matches - 1) : 0ull;
 }
 
-int part2(const card_t& card, std::vector<int>& won_cards) {
-    int matches = num_matches(card);
+// Copies still owed to the cards ahead, as a difference array over a ring: a card with `copies` copies and
+// `matches` matches adds `copies` at the next card and takes it back `matches + 1` cards on. A card wins
+// at most 128 matches, so 256 slots never alias a live entry, and each card costs O(1) whatever its match
+// count. Counts are 64-bit; the wrapping subtraction is exact as long as the real counts fit.
+class copy_counter_t {
+public:
+    // Records the next card and returns how many copies of it there are.
+    uint64_t add(int matches) {
+        assert(matches >= 0 && matches <= 128);
+        auto& slot = _ring[_card & mask];
+        _owed += slot;
+        slot = 0ull;
 
-    auto cur_index = card.id - 1;
-    assert(won_cards.size() >= cur_index);
-    if (won_cards.size() == cur_index) {
-        won_cards.push_back(1);
+        uint64_t copies = 1ull + _owed;
+        if (matches > 0) {
+            _ring[(_card + 1ull) & mask] += copies;
+            _ring[(_card + static_cast<uint64_t>(matches) + 1ull) & mask] -= copies;
+        }
+        _card++;
+        return copies;
     }
 
-    for (int i = 1; i <= matches; i++) {
-        if (won_cards.size() == cur_index + i) {
-            won_cards.push_back(1 + won_cards[cur_index]);
-        } else {
-            won_cards[cur_index + i] += won_cards[cur_index];
-        }
+private:
+    static constexpr uint64_t mask = 255ull;
+
+    std::array<uint64_t, mask + 1ull> _ring{};
+    // copies owed to the current card by the cards before it
+    uint64_t _owed = 0ull;
+    uint64_t _card = 0ull;
+};
+
+// Builds the two masks straight from "Card <id>: <winning numbers> | <test numbers>". Throws
+// io::input_error_t for a line without that shape or with a number the masks cannot hold.
+card_t parse_line(std::string_view line) {
+    auto end = line.data() + line.size();
+    auto colon = static_cast<const char*>(std::memchr(line.data(), ':', line.size()));
+    if (colon == nullptr) {
+        throw advent::io::input_error_t("expected \"Card <id>: <numbers> | <numbers>\"", line);
     }
 
-    return won_cards[cur_index];
+    card_t card;
+    auto parse_numbers = [line, end](const char* p, mask128_t& numbers) {
+        auto res = advent::numbers::parse_next<uint32_t>(p, end);
+        for (; res; res = advent::numbers::parse_next<uint32_t>(res.ptr, end)) {
+            if (res.value >= 128u) {
+                throw advent::io::input_error_t("card numbers must be below 128", line);
+            }
+            numbers.set(res.value);
+        }
+        // stopped at whatever follows the numbers; an out of range number is an error here too
+        if (res.ec != std::errc::invalid_argument) {
+            throw advent::io::input_error_t("card numbers must be below 128", line);
+        }
+        return res.ptr;
+    };
+    auto bar = parse_numbers(colon + 1, card.winning_numbers);
+    if (bar == end || *bar != '|' || parse_numbers(bar + 1, card.test_numbers) != end) {
+        throw advent::io::input_error_t("expected \"Card <id>: <numbers> | <numbers>\"", line);
+    }
+    return card;
 }
 
-card_t parse_line(const std::string& line) {
-    auto card_split = advent::strings::split(line, ':');
-    assert(card_split.size() == 2ul);
-    card_t card;
-    card.id = std::stoi(advent::strings::split(card_split.front(), ' ').back());
+// Real and generated inputs print every card the same way: a fixed width "Card <id>:" prefix, then the
+// numbers in right-aligned two character columns separated by single spaces. layout_t captures those
+// offsets from the first line and decodes the lines after it 16 bytes at a time, checking each line
+// against the layout as it goes; lines that do not fit are left to parse_line.
+class layout_t {
+public:
+    // The layout of `line`, if it has the fixed column shape.
+    static std::optional<layout_t> detect(std::string_view line) {
+        auto colon = line.find(':');
+        auto bar = line.find('|');
+        if (colon == std::string_view::npos || bar == std::string_view::npos || bar < colon) {
+            return std::nullopt;
+        }
+        // past the colon: " dd" per winning number, " |", then " dd" per test number
+        auto columns = line.size() - colon - 1ul;
+        auto bar_column = bar - colon - 1ul;
+        if (columns < block_size || columns > max_columns || bar_column % 3ul != 1ul
+            || (columns - bar_column - 1ul) % 3ul != 0ul) {
+            return std::nullopt;
+        }
+
+        layout_t layout(line.size(), colon, bar_column / 3ul, (columns - bar_column - 1ul) / 3ul);
+        card_t card;
+        if (!layout.decode(line, card)) {
+            return std::nullopt;
+        }
+        return layout;
+    }
+
+    // Decodes `line` into `card`, or returns false if the line does not match the layout.
+    bool decode(std::string_view line, card_t& card) const {
+        if (line.size() != _length || line[_colon] != ':' || line[_colon + 1ul + _bar] != '|') {
+            return false;
+        }
+
+        // values[c] = 10 * digit(c) + digit(c + 1), a space counting as 0, so each column's number lands
+        // on the byte of its tens digit
+        uint8_t values[max_columns];
+        auto columns = line.data() + _colon + 1ul;
+        for (size_t b = 0ul; b < _num_blocks; b++) {
+            if (!decode_block(columns, _blocks[b], values)) {
+                return false;
+            }
+        }
+
+        for (size_t i = 0ul; i < _num_winning; i++) {
+            card.winning_numbers.set(values[1ul + 3ul * i]);
+        }
+        for (size_t i = 0ul, tens = _bar + 2ul; i < _num_test; i++, tens += 3ul) {
+            card.test_numbers.set(values[tens]);
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t block_size = 16ul;
+    static constexpr size_t max_columns = 256ul;
 
-    auto winning_split = advent::strings::split(card_split[1], '|');
-    assert(winning_split.size() == 2ul);
+    // A 16 byte window over the columns with the bytes that must be a digit (units), a digit or a space
+    // (tens) and a space (separators). The '|' is in none of them.
+    struct block_t {
+        size_t offset;
+        uint32_t units;
+        uint32_t tens;
+        uint32_t spaces;
+    };
 
-    for (auto num : advent::strings::split(winning_split.front(), ' ')) {
-        num.erase(num.begin(), std::find_if(num.begin(), num.end(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }));
-        if (!num.empty()) {
-            card.winning_numbers.push_back(std::stoi(num));
+    layout_t(size_t length, size_t colon, size_t num_winning, size_t num_test)
+        : _length(length), _colon(colon), _bar(3ul * num_winning + 1ul), _num_winning(num_winning),
+          _num_test(num_test) {
+        auto columns = length - colon - 1ul;
+        // a block yields 15 values (the last byte has no units digit), so blocks step by 15 and the last
+        // one is pulled back to end at the last column
+        for (size_t offset = 0ul;; offset += block_size - 1ul) {
+            auto last = offset + block_size >= columns;
+            _blocks[_num_blocks++] = make_block(last ? columns - block_size : offset);
+            if (last) {
+                break;
+            }
         }
     }
-    for (auto num : advent::strings::split(winning_split[1], ' ')) {
-        num.erase(num.begin(), std::find_if(num.begin(), num.end(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }));
-        if (!num.empty()) {
-            card.test_numbers.push_back(std::stoi(num));
+
+    block_t make_block(size_t offset) const {
+        block_t block{offset, 0u, 0u, 0u};
+        for (size_t b = 0ul; b < block_size; b++) {
+            auto column = offset + b;
+            if (column == _bar) {
+                continue;
+            }
+            // " |" shifts the test columns two bytes along from the winning ones
+            auto phase = (column < _bar ? column : column - 2ul) % 3ul;
+            auto bit = 1u << b;
+            (phase == 0ul ? block.spaces : phase == 1ul ? block.tens : block.units) |= bit;
         }
+        return block;
     }
 
-    assert(!card.winning_numbers.empty());
-    assert(!card.test_numbers.empty());
-    return card;
+    static bool decode_block(const char* columns, const block_t& block, uint8_t* values) {
+        auto p = columns + block.offset;
+#if defined(__SSE2__)
+        auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto offsets = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+        // unsigned c - '0' < 10, done as a signed compare after flipping the sign bits
+        auto is_digit = _mm_cmplt_epi8(_mm_xor_si128(offsets, _mm_set1_epi8(-128)), _mm_set1_epi8(10 - 128));
+        auto is_space = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+        auto digit_mask = static_cast<uint32_t>(_mm_movemask_epi8(is_digit));
+        auto space_mask = static_cast<uint32_t>(_mm_movemask_epi8(is_space));
+
+        auto digits = _mm_and_si128(offsets, is_digit);
+        auto twice = _mm_add_epi8(digits, digits);
+        auto eight_times = _mm_add_epi8(_mm_add_epi8(twice, twice), _mm_add_epi8(twice, twice));
+        auto value = _mm_add_epi8(_mm_add_epi8(eight_times, twice), _mm_srli_si128(digits, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + block.offset), value);
+#else
+        uint32_t digit_mask = 0u, space_mask = 0u;
+        uint8_t digits[block_size + 1ul] = {};
+        for (size_t b = 0ul; b < block_size; b++) {
+            auto digit = static_cast<uint8_t>(p[b] - '0');
+            if (digit < 10u) {
+                digit_mask |= 1u << b;
+                digits[b] = digit;
+            }
+            space_mask |= static_cast<uint32_t>(p[b] == ' ') << b;
+        }
+        for (size_t b = 0ul; b < block_size; b++) {
+            values[block.offset + b] = static_cast<uint8_t>(10u * digits[b] + digits[b + 1ul]);
+        }
+#endif
+        return (digit_mask & block.units) == block.units && (space_mask & block.spaces) == block.spaces
+            && ((digit_mask | space_mask) & block.tens) == block.tens;
+    }
+
+    size_t _length;
+    size_t _colon;
+    // offset of the '|' from the first column
+    size_t _bar;
+    size_t _num_winning;
+    size_t _num_test;
+    std::array<block_t, max_columns / (block_size - 1ul) + 1ul> _blocks{};
+    size_t _num_blocks = 0ul;
+};
+
+// Decodes with `layout` where it applies and with the generic parser otherwise.
+card_t parse_card(std::string_view line, const layout_t* layout) {
+    card_t card;
+    if (layout && layout->decode(line, card)) {
+        return card;
+    }
+    ADVENT_METRICS_COUNT("day4.generic_lines", 1);
+    return parse_line(line);
+}
+
+using cards_t = std::vector<card_t>;
+
+// Runs count_matches over the cards a block at a time and hands each block of counts to `f`.
+template <typename F>
+void for_each_match_block(const cards_t& cards, F f) {
+    constexpr size_t block_size = 1024ul;
+    uint8_t matches[block_size];
+    for (size_t begin = 0ul; begin < cards.size(); begin += block_size) {
+        auto n = std::min(block_size, cards.size() - begin);
+        count_matches(cards.data() + begin, n, matches);
+        f(matches, n);
+    }
+}
+
+uint64_t part1(const cards_t& cards) {
+    uint64_t sum = 0;
+    for_each_match_block(cards, [&sum](const uint8_t* matches, size_t n) {
+        for (size_t i = 0ul; i < n; i++) {
+            sum += part1_card(matches[i]);
+        }
+    });
+    return sum;
 }
 
-void run_solution() {
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day4/input.txt");
-    if (input_file.is_open()) {
-        int part1_sum = 0;
-        int part2_sum = 0;
-        std::vector<int> won_cards;
-        while (std::getline(input_file, line)) {
-            auto card = parse_line(line);
-            part1_sum += part1(card);
-            part2_sum += part2(card, won_cards);
-        }
-        input_file.close();
-
-        std::cout << "Part 1: " << part1_sum << std::endl;
-        std::cout << "Part 2: " << part2_sum << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+uint64_t part2(const cards_t& cards) {
+    uint64_t sum = 0;
+    copy_counter_t copies;
+    for_each_match_block(cards, [&](const uint8_t* matches, size_t n) {
+        for (size_t i = 0ul; i < n; i++) {
+            sum += copies.add(matches[i]);
+        }
+    });
+    return sum;
+}
+
+std::pair<uint64_t, uint64_t> solve_stream(advent::io::line_reader_t& lines) {
+    std::pair<uint64_t, uint64_t> sums{0, 0};
+    copy_counter_t copies;
+    std::optional<layout_t> layout;
+    for (std::string_view line; lines.next(line);) {
+        if (line.empty()) {
+            continue;
+        }
+        // every card adds at least one to part 2, so the sum is 0 only before the first line
+        if (sums.second == 0) {
+            layout = layout_t::detect(line);
+        }
+        auto matches = num_matches(parse_card(line, layout ? &*layout : nullptr));
+        ADVENT_METRICS_COUNT("day4.cards", 1);
+        sums.first += part1_card(matches);
+        sums.second += copies.add(matches);
     }
+    return sums;
 }
 
-int main() {
-    run_solution();
-    return 0;
+cards_t parse(std::string_view input) {
+    std::optional<layout_t> layout;
+    for (auto line : advent::io::lines_t(input)) {
+        layout = layout_t::detect(line);
+        break;
+    }
+
+    auto chunks = advent::parallel::parallel_map_chunks(input, [&layout](std::string_view chunk) {
+        cards_t cards;
+        for (auto line : advent::io::lines_t(chunk)) {
+            if (line.empty()) {
+                continue;
+            }
+            cards.push_back(parse_card(line, layout ? &*layout : nullptr));
+        }
+        ADVENT_METRICS_COUNT("day4.cards", cards.size());
+        return cards;
+    });
+
+    cards_t cards;
+    for (const auto& chunk : chunks) {
+        cards.insert(cards.end(), chunk.cbegin(), chunk.cend());
+    }
+    return cards;
 }
+
+} // namespace day4
+
+ADVENT_REGISTER_DAY(4, day4::parse, day4::part1, day4::part2);
+ADVENT_REGISTER_STREAM(4, day4::solve_stream);
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "range_map.h"
+
+#include <limits>
+#include <string>
+
+#include <cassert>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include <common/input_error.h>
+#include <common/parallel.h>
+
+namespace day5 {
+
+namespace {
+
+// Segment tables as the batch kernels see them.
+struct table_t {
+    const uint64_t* starts;
+    const int64_t* offsets;
+    size_t size;
+};
+
+// Sorted search for `Lanes` sources side by side: the steps of each search still depend on each other,
+// but the loads of the different sources do not, so the core keeps them all in flight.
+template <size_t Lanes>
+void lookup_group(const table_t& table, const uint64_t* sources, uint64_t* results) {
+    uint64_t keys[Lanes];
+    size_t base[Lanes] = {};
+    std::copy(sources, sources + Lanes, keys);
+    for (auto n = table.size; n > 1ul;) {
+        auto half = n / 2ul;
+        for (size_t l = 0ul; l < Lanes; l++) {
+            base[l] = table.starts[base[l] + half] <= keys[l] ? base[l] + half : base[l];
+        }
+        n -= half;
+    }
+    for (size_t l = 0ul; l < Lanes; l++) {
+        results[l] = keys[l] + static_cast<uint64_t>(table.offsets[base[l]]);
+    }
+}
+
+void lookup_scalar(const table_t& table, const uint64_t* sources, size_t n, uint64_t* results) {
+    constexpr size_t lanes = 8ul;
+    size_t i = 0ul;
+    for (; i + lanes <= n; i += lanes) {
+        lookup_group<lanes>(table, sources + i, results + i);
+    }
+    for (; i < n; i++) {
+        lookup_group<1ul>(table, sources + i, results + i);
+    }
+}
+
+#if defined(__x86_64__)
+
+// Two vectors of four 64-bit lanes. AVX2 only compares signed 64-bit integers, so keys and starts are
+// compared with their sign bits flipped.
+__attribute__((target("avx2")))
+void lookup_avx2(const table_t& table, const uint64_t* sources, size_t n, uint64_t* results) {
+    constexpr size_t lanes = 8ul;
+    const auto sign = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+    auto starts = reinterpret_cast<const long long*>(table.starts);
+    auto offsets = reinterpret_cast<const long long*>(table.offsets);
+    size_t i = 0ul;
+    for (; i + lanes <= n; i += lanes) {
+        auto s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sources + i));
+        auto s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sources + i + 4ul));
+        auto k0 = _mm256_xor_si256(s0, sign);
+        auto k1 = _mm256_xor_si256(s1, sign);
+        auto b0 = _mm256_setzero_si256();
+        auto b1 = _mm256_setzero_si256();
+        for (auto m = table.size; m > 1ul;) {
+            auto half = _mm256_set1_epi64x(static_cast<long long>(m / 2ul));
+            auto p0 = _mm256_i64gather_epi64(starts, _mm256_add_epi64(b0, half), 8);
+            auto p1 = _mm256_i64gather_epi64(starts, _mm256_add_epi64(b1, half), 8);
+            // step right where start <= key, that is where !(start > key)
+            b0 = _mm256_add_epi64(b0, _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_xor_si256(p0, sign), k0), half));
+            b1 = _mm256_add_epi64(b1, _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_xor_si256(p1, sign), k1), half));
+            m -= m / 2ul;
+        }
+        auto r0 = _mm256_add_epi64(s0, _mm256_i64gather_epi64(offsets, b0, 8));
+        auto r1 = _mm256_add_epi64(s1, _mm256_i64gather_epi64(offsets, b1, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i), r0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(results + i + 4ul), r1);
+    }
+    lookup_scalar(table, sources + i, n - i, results + i);
+}
+
+// Two vectors of eight 64-bit lanes, with unsigned compares into masks. The gathers take an explicit zero
+// source and full mask: the unmasked intrinsic is built on an uninitialized source vector, which
+// -Wmaybe-uninitialized reports.
+__attribute__((target("avx512f")))
+void lookup_avx512(const table_t& table, const uint64_t* sources, size_t n, uint64_t* results) {
+    constexpr size_t lanes = 16ul;
+    constexpr __mmask8 all = 0xff;
+    auto zero = _mm512_setzero_si512();
+    size_t i = 0ul;
+    for (; i + lanes <= n; i += lanes) {
+        auto s0 = _mm512_loadu_si512(sources + i);
+        auto s1 = _mm512_loadu_si512(sources + i + 8ul);
+        auto b0 = _mm512_setzero_si512();
+        auto b1 = _mm512_setzero_si512();
+        for (auto m = table.size; m > 1ul;) {
+            auto half = _mm512_set1_epi64(static_cast<long long>(m / 2ul));
+            auto p0 = _mm512_mask_i64gather_epi64(zero, all, _mm512_add_epi64(b0, half), table.starts, 8);
+            auto p1 = _mm512_mask_i64gather_epi64(zero, all, _mm512_add_epi64(b1, half), table.starts, 8);
+            b0 = _mm512_mask_add_epi64(b0, _mm512_cmple_epu64_mask(p0, s0), b0, half);
+            b1 = _mm512_mask_add_epi64(b1, _mm512_cmple_epu64_mask(p1, s1), b1, half);
+            m -= m / 2ul;
+        }
+        auto r0 = _mm512_add_epi64(s0, _mm512_mask_i64gather_epi64(zero, all, b0, table.offsets, 8));
+        auto r1 = _mm512_add_epi64(s1, _mm512_mask_i64gather_epi64(zero, all, b1, table.offsets, 8));
+        _mm512_storeu_si512(results + i, r0);
+        _mm512_storeu_si512(results + i + 8ul, r1);
+    }
+    lookup_scalar(table, sources + i, n - i, results + i);
+}
+
+#endif
+
+// fewer sources than this per thread are not worth a thread
+constexpr size_t min_batch_per_thread = 1ul << 14;
+
+} // namespace
+
+void range_map_t::build() {
+    std::sort(_entries.begin(), _entries.end(), [](const range_entry_t& a, const range_entry_t& b) {
+        return a.source_range().start < b.source_range().start;
+    });
+
+    _starts.clear();
+    _offsets.clear();
+
+    uint64_t covered = 0ull;
+    for (const auto& e : _entries) {
+        const auto& source = e.source_range();
+        if (source.empty()) {
+            continue;
+        }
+        // sources may not overlap
+        if (source.start < covered) {
+            throw advent::io::input_error_t("map entries overlap at source " + std::to_string(source.start));
+        }
+        if (source.start > covered) {
+            add_segment(covered, 0);
+        }
+        add_segment(source.start, e.offset());
+        covered = source.end;
+    }
+    // `covered` wraps to 0 only if the last entry runs to the top of the value range
+    if (_starts.empty() || covered != 0ull) {
+        add_segment(covered, 0);
+    }
+    build_search();
+}
+
+void range_map_t::add_segment(uint64_t start, int64_t offset) {
+    // a segment with the offset of the one before it just extends that one
+    if (!_offsets.empty() && _offsets.back() == offset) {
+        return;
+    }
+    _starts.push_back(start);
+    _offsets.push_back(offset);
+}
+
+void range_map_t::build_search() {
+    _eytzinger_starts.clear();
+    _eytzinger_preceding_offsets.clear();
+    if (_starts.size() >= eytzinger_min_segments) {
+        _eytzinger_starts.resize(_starts.size() + 1ul);
+        _eytzinger_preceding_offsets.resize(_starts.size() + 1ul);
+        [[maybe_unused]] auto filled = fill_eytzinger(0ul, 1ul);
+        assert(filled == _starts.size());
+    }
+}
+
+// In-order walk of the implicit tree rooted at slot `k`, handing out the sorted starts from index `i`.
+size_t range_map_t::fill_eytzinger(size_t i, size_t k) {
+    if (k < _eytzinger_starts.size()) {
+        i = fill_eytzinger(i, 2ul * k);
+        _eytzinger_starts[k] = _starts[i];
+        _eytzinger_preceding_offsets[k] = i ? _offsets[i - 1ul] : 0;
+        i = fill_eytzinger(i + 1ul, 2ul * k + 1ul);
+    }
+    return i;
+}
+
+range_map_t range_map_t::compose(const range_map_t& first, const range_map_t& second) {
+    assert(first._offsets.back() == 0 && second._offsets.back() == 0);
+    range_map_t composed;
+    for (size_t i = 0ul; i < first._starts.size(); i++) {
+        auto offset = first._offsets[i];
+        // walk the image of segment i through the segments of `second` it overlaps
+        auto image = first._starts[i] + static_cast<uint64_t>(offset);
+        auto image_end = first.segment_end(i) + static_cast<uint64_t>(offset);
+        for (auto j = second.segment_index(image); image < image_end; j++) {
+            composed.add_segment(image - static_cast<uint64_t>(offset), offset + second._offsets[j]);
+            image = std::min(image_end, second.segment_end(j));
+        }
+    }
+    composed.build_search();
+    return composed;
+}
+
+bool range_map_t::supports(batch_kernel_t kernel) {
+    switch (kernel) {
+    case batch_kernel_t::scalar:
+        return true;
+#if defined(__x86_64__)
+    case batch_kernel_t::avx2:
+        return __builtin_cpu_supports("avx2");
+    case batch_kernel_t::avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+range_map_t::batch_kernel_t range_map_t::best_batch_kernel() {
+    static const auto best = [] {
+        for (auto kernel : {batch_kernel_t::avx512, batch_kernel_t::avx2}) {
+            if (supports(kernel)) {
+                return kernel;
+            }
+        }
+        return batch_kernel_t::scalar;
+    }();
+    return best;
+}
+
+void range_map_t::lookup_batch(const uint64_t* sources, size_t n, uint64_t* results, batch_kernel_t kernel) const {
+    assert(supports(kernel));
+    ADVENT_METRICS_COUNT("day5.range_map.batch_lookup", n);
+    table_t table{_starts.data(), _offsets.data(), _starts.size()};
+    auto lookup = lookup_scalar;
+#if defined(__x86_64__)
+    if (kernel == batch_kernel_t::avx2) {
+        lookup = lookup_avx2;
+    } else if (kernel == batch_kernel_t::avx512) {
+        lookup = lookup_avx512;
+    }
+#endif
+    advent::parallel::parallel_map_range(n, min_batch_per_thread, [&](size_t begin, size_t end) {
+        lookup(table, sources + begin, end - begin, results + begin);
+        return end - begin;
+    });
+}
+
+void range_map_t::map_range(const range_t& sources, range_set_t& images) const {
+    auto start = sources.start;
+    for (auto i = segment_index(start); start < sources.end; i++) {
+        auto end = std::min(sources.end, segment_end(i));
+        auto offset = static_cast<uint64_t>(_offsets[i]);
+        images.push_back(range_t{start + offset, end + offset});
+        start = end;
+    }
+}
+
+uint64_t range_map_t::min_lookup(const range_t& sources) const {
+    uint64_t min_location = ~0ull;
+    if (sources.empty()) {
+        return min_location;
+    }
+    for (auto i = segment_index(sources.start); i < _starts.size() && _starts[i] < sources.end; i++) {
+        auto first = std::max(_starts[i], sources.start);
+        min_location = std::min(min_location, first + static_cast<uint64_t>(_offsets[i]));
+    }
+    return min_location;
+}
+
+uint64_t propagate_min(const range_map_t* maps, size_t num_maps, const range_t* seeds, size_t num_seeds,
+                       range_buffers_t& buffers) {
+    auto& ranges = buffers.current();
+    ranges.clear();
+    for (size_t i = 0ul; i < num_seeds; i++) {
+        ranges.push_back(seeds[i]);
+    }
+    ranges.normalize();
+
+    for (size_t m = 0ul; m < num_maps; m++) {
+        auto& images = buffers.next();
+        images.clear();
+        for (const auto& r : buffers.current()) {
+            maps[m].map_range(r, images);
+        }
+        images.normalize();
+        buffers.flip();
+        ADVENT_METRICS_RECORD("day5.propagated_ranges", images.size());
+    }
+    auto& locations = buffers.current();
+    return locations.empty() ? std::numeric_limits<uint64_t>::max() : locations.front().start;
+}
+
+} // namespace day5
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <common/interval_set.h>
+#include <common/metrics.h>
+
+namespace day5 {
+
+using range_t = advent::intervals::interval_t<uint64_t>;
+// Propagated range sets stay in the inline buffer for typical almanacs.
+using range_set_t = advent::intervals::interval_set_t<uint64_t, 64ul>;
+using range_buffers_t = advent::intervals::interval_buffers_t<uint64_t, 64ul>;
+
+class range_entry_t {
+public:
+    range_entry_t(uint64_t source_start, uint64_t destination_start, uint64_t length)
+        : _source_range({source_start, source_start + length}),
+          _destination_range({destination_start, destination_start + length}),
+          _offset(static_cast<int64_t>(destination_start) - static_cast<int64_t>(source_start)) {}
+
+    uint64_t lookup(uint64_t source) const {
+        if (!_source_range.contains(source)) {
+            return source;
+        }
+        return static_cast<uint64_t>(static_cast<int64_t>(source) + _offset);
+    }
+
+    const range_t& source_range() const {
+        return _source_range;
+    }
+
+    const range_t& destination_range() const {
+        return _destination_range;
+    }
+
+    int64_t offset() const {
+        return _offset;
+    }
+
+private:
+    range_t _source_range;
+    range_t _destination_range;
+    int64_t _offset;
+};
+
+// One almanac map. After build() the map is a flat table of segments covering every source value: the
+// entries sorted by source start, with the gaps between them filled by identity segments and adjacent
+// segments of equal offset merged. A segment runs from its start up to the next one's, so a lookup is a
+// predecessor search over the starts plus one add.
+class range_map_t {
+public:
+    // tables with fewer segments than this fit in L2 and are searched in sorted order
+    static constexpr size_t eytzinger_min_segments = 1ul << 15;
+
+    // Instruction sets lookup_batch() can search with; avx2 and avx512 are used only where the CPU
+    // running the program has them.
+    enum class batch_kernel_t { scalar, avx2, avx512 };
+
+    static bool supports(batch_kernel_t kernel);
+    static batch_kernel_t best_batch_kernel();
+
+    range_map_t() = default;
+
+    void insert(range_entry_t&& entry) {
+        _entries.push_back(entry);
+    }
+
+    // Sorts the entries and lays out the segment table; call once every entry is inserted. Throws
+    // io::input_error_t if two entries map the same source.
+    void build();
+
+    // The map that applies `first`, then `second`: the segments of `first`, each split where its image
+    // crosses a segment start of `second`, with the offsets summed. Neither map may move the top segment,
+    // the one reaching the end of the value range.
+    static range_map_t compose(const range_map_t& first, const range_map_t& second);
+
+    uint64_t lookup(uint64_t source) const {
+        ADVENT_METRICS_COUNT("day5.range_map.lookup", 1);
+        return _eytzinger_starts.empty() ? lookup_sorted(source) : lookup_eytzinger(source);
+    }
+
+    // Branchless binary search over the sorted starts: every step is a conditional move, so the only
+    // cost is the chain of dependent loads.
+    uint64_t lookup_sorted(uint64_t source) const {
+        return source + static_cast<uint64_t>(_offsets[segment_index(source)]);
+    }
+
+    // Search over the starts in Eytzinger (breadth-first) order, used once the table outgrows the cache:
+    // the nodes three levels down sit in the line prefetched at each step, so the misses overlap
+    // instead of queueing behind each other.
+    uint64_t lookup_eytzinger(uint64_t source) const {
+        size_t k = 1ul;
+        auto n = _eytzinger_starts.size();
+        while (k < n) {
+            // the descendants three levels down are 8 consecutive slots; prefetching past the end is harmless
+            __builtin_prefetch(_eytzinger_starts.data() + 8ul * k);
+            k = 2ul * k + (_eytzinger_starts[k] <= source);
+        }
+        // drop the trailing right turns: k is then the first start above `source`, or 0 if there is none
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+        return source + static_cast<uint64_t>(k ? _eytzinger_preceding_offsets[k] : _offsets.back());
+    }
+
+    // Looks up `n` sources at once into `results`, which may be `sources`. Each kernel runs the sorted
+    // search on a group of sources in lockstep (8 for scalar and AVX2, 16 for AVX-512), so the loads of
+    // the group overlap; large batches are also split across the worker threads. Gathers only pay off
+    // once the loads miss the cache, so small tables use the scalar kernel.
+    void lookup_batch(const uint64_t* sources, size_t n, uint64_t* results) const {
+        auto large = _starts.size() >= eytzinger_min_segments;
+        lookup_batch(sources, n, results, large ? best_batch_kernel() : batch_kernel_t::scalar);
+    }
+    void lookup_batch(const uint64_t* sources, size_t n, uint64_t* results, batch_kernel_t kernel) const;
+
+    // Appends the image of `sources` to `images`, one range per segment it overlaps.
+    void map_range(const range_t& sources, range_set_t& images) const;
+
+    // Smallest lookup() over `sources`. Each segment maps its sources in order, so the minimum is at the
+    // first source of one of the segments `sources` overlaps.
+    uint64_t min_lookup(const range_t& sources) const;
+
+    // number of inserted entries
+    size_t size() const { return _entries.size(); }
+    size_t num_segments() const { return _starts.size(); }
+
+private:
+    // index of the segment holding `source`
+    size_t segment_index(uint64_t source) const {
+        auto base = _starts.data();
+        for (auto n = _starts.size(); n > 1ul;) {
+            auto half = n / 2ul;
+            base = base[half] <= source ? base + half : base;
+            n -= half;
+        }
+        return static_cast<size_t>(base - _starts.data());
+    }
+
+    // one past the last source of segment `i`; the top segment ends at the largest value
+    uint64_t segment_end(size_t i) const {
+        return i + 1ul < _starts.size() ? _starts[i + 1ul] : ~0ull;
+    }
+
+    void add_segment(uint64_t start, int64_t offset);
+    // lays out the search structures over _starts
+    void build_search();
+    size_t fill_eytzinger(size_t i, size_t k);
+
+    // sorted by source start; empty for composed maps
+    std::vector<range_entry_t> _entries;
+    // segment starts (the first is 0) and the offset added to sources in each segment
+    std::vector<uint64_t> _starts;
+    std::vector<int64_t> _offsets;
+    // 1-based Eytzinger order of _starts (slot 0 unused) and, for each, the offset of the segment
+    // just before it
+    std::vector<uint64_t> _eytzinger_starts;
+    std::vector<int64_t> _eytzinger_preceding_offsets;
+};
+
+// Smallest location of `num_seeds` seed ranges pushed through `num_maps` maps in turn as sets of intervals,
+// split wherever a range crosses a segment boundary and merged again after each map. The work depends on
+// the number of intervals, never on how many seeds they hold, and the smallest location is the lowest
+// interval start. The sets alternate within `buffers`; once those have grown to fit a query, later queries
+// run without allocating.
+uint64_t propagate_min(const range_map_t* maps, size_t num_maps, const range_t* seeds, size_t num_seeds,
+                       range_buffers_t& buffers);
+
+} // namespace day5
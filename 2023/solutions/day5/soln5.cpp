@@ -1,250 +1,263 @@
 #include <algorithm>
-#include <fstream>
-#include <iostream>
+#include <charconv>
 #include <limits>
-#include <map>
+#include <memory>
+#include <numeric>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <vector>
 
-#include <common/strings.h>
-
-#include <cassert>
+#include <common/input_error.h>
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/numbers.h>
+#include <common/parallel.h>
+#include <common/query_server.h>
+#include <common/runner.h>
 
+#include "range_map.h"
 
-struct range_t {
-    uint64_t start;
-    uint64_t end; // exclusive
+#include <cassert>
 
-    bool contains(uint64_t v) const {
-        return v >= start && v < end;
-    }
+namespace day5 {
 
-    range_t intersect(const range_t& other) const {
-        if (other.end < start || other.start > end) {
-            return range_t{0ul, 0ul};
-        }
-        return range_t{std::max(start, other.start), std::min(end, other.end)};
-    }
-
-    bool empty() const { return start == end; }
+struct almanac_t {
+    // the numbers on the seeds line
+    std::vector<uint64_t> seeds;
+    std::vector<range_map_t> maps;
+    // every map composed into one, seed straight to location
+    range_map_t seed_to_location;
 };
 
-class range_entry_t {
-public:
-    range_entry_t(uint64_t source_start, uint64_t destination_start, uint64_t length)
-        : _source_range({source_start, source_start + length}),
-          _destination_range({destination_start, destination_start + length}),
-          _offset(static_cast<int64_t>(destination_start) - static_cast<int64_t>(source_start)) {}
-
-    uint64_t lookup(uint64_t source) const {
-        if (!_source_range.contains(source)) {
-            return source;
-        }
-        return static_cast<uint64_t>(static_cast<int64_t>(source) + _offset);
-    }
-
-    range_t reverse_lookup(const range_t& dest_range, std::vector<range_t>& unmatched_ranges) const {
-        auto intersection = _destination_range.intersect(dest_range);
-
-        if (intersection.empty()) {
-            unmatched_ranges.emplace_back(dest_range);
-            return intersection;
+// Part 1 reads the seeds line as single seeds, part 2 as (start, length) pairs; throws io::input_error_t
+// if they do not pair up.
+void seed_ranges(const almanac_t& almanac, bool pairs, range_set_t& ranges) {
+    ranges.clear();
+    if (!pairs) {
+        for (auto seed : almanac.seeds) {
+            ranges.push_back(range_t{seed, seed + 1ul});
         }
-
-        if (intersection.start != dest_range.start) {
-            unmatched_ranges.emplace_back(range_t{dest_range.start, intersection.start});
-        }
-
-        if (intersection.end != dest_range.end) {
-            unmatched_ranges.emplace_back(range_t{intersection.end, dest_range.end});
-        }
-
-        return{static_cast<uint64_t>(static_cast<int64_t>(intersection.start) - _offset),
-               static_cast<uint64_t>(static_cast<int64_t>(intersection.end) - _offset)};
+        return;
     }
-
-    const range_t& source_range() const {
-        return _source_range;
+    if (almanac.seeds.size() % 2 != 0) {
+        throw advent::io::input_error_t("expected the seeds to pair up into (start, length) ranges");
     }
-
-    const range_t& destination_range() const {
-        return _destination_range;
+    for (size_t i = 0ul; i < almanac.seeds.size(); i += 2ul) {
+        auto start = almanac.seeds[i];
+        auto end = start + almanac.seeds[i + 1ul];
+        if (end < start) {
+            throw advent::io::input_error_t("seed range runs past the largest seed");
+        }
+        ranges.push_back(range_t{start, end});
     }
+}
 
-private:
-    range_t _source_range;
-    range_t _destination_range;
-    int64_t _offset;
-};
-
-class range_map_t {
-public:
-    range_map_t() = default;
-
-    void insert(range_entry_t&& entry) {
-        _map.emplace(entry.source_range().start, std::move(entry));
+// Brute force: every seed through every map in turn, for checking the composed map. The seeds are split
+// across the worker threads, and each thread pushes a block of consecutive seeds at a time through the
+// maps with lookup_batch.
+uint64_t forward_lookup(const almanac_t& almanac, const range_set_t& seed_ranges) {
+    constexpr size_t block_size = 4096ul;
+    // index of the first seed of each range among all the seeds
+    std::vector<uint64_t> firsts;
+    uint64_t num_seeds = 0ull;
+    for (const auto& r : seed_ranges) {
+        firsts.push_back(num_seeds);
+        num_seeds += r.end - r.start;
     }
 
-    uint64_t lookup(uint64_t source) const {
-        for (auto& e : _map) {
-            if (source >= e.first) {
-                if (uint64_t dest = e.second.lookup(source); dest != source) {
-                    return dest;
-                }
+    auto mins = advent::parallel::parallel_map_range(num_seeds, block_size, [&](size_t begin, size_t end) {
+        std::vector<uint64_t> block(block_size);
+        uint64_t min_location = std::numeric_limits<uint64_t>::max();
+        auto r = static_cast<size_t>(std::upper_bound(firsts.cbegin(), firsts.cend(), begin) - firsts.cbegin()) - 1ul;
+        for (auto i = begin; i < end;) {
+            while (i - firsts[r] >= seed_ranges[r].end - seed_ranges[r].start) {
+                r++;
             }
-        }
-        return source;
-    }
-
-    std::vector<range_t> reverse_lookup(const range_t& dest_range) const {
-        std::vector<range_t> source_ranges;
-        std::vector<range_t> unmatched_ranges = {dest_range};
-        for (auto& e : _map) {
-            std::vector<range_t> uranges;
-            for (const range_t& range : unmatched_ranges) {
-                if (auto srange = e.second.reverse_lookup(range, uranges); !srange.empty()) {
-                    source_ranges.push_back(srange);
-                }
+            auto first_seed = seed_ranges[r].start + (i - firsts[r]);
+            auto n = std::min({block_size, end - i, static_cast<size_t>(seed_ranges[r].end - first_seed)});
+            std::iota(block.begin(), block.begin() + n, first_seed);
+            for (const auto& m : almanac.maps) {
+                m.lookup_batch(block.data(), n, block.data());
             }
-            unmatched_ranges = uranges;
-        }
-        for (const range_t& range : unmatched_ranges) {
-            source_ranges.push_back(range);
-        }
-        return source_ranges;
-    }
-
-    std::map<uint64_t, range_entry_t> reverse_map() const {
-        std::map<uint64_t, range_entry_t> rmap;
-        for (const auto& e : _map) {
-            rmap.emplace(e.second.destination_range().start, e.second);
+            min_location = std::min(min_location, *std::min_element(block.cbegin(), block.cbegin() + n));
+            i += n;
         }
-        return rmap;
-    }
-
-private:
-    std::map<uint64_t, range_entry_t> _map;
-};
-
-struct almanac_t {
-    std::vector<range_t> seeds;
-    std::vector<range_map_t> maps;
-};
-
-uint64_t lookup_location(const almanac_t& almanac, uint64_t source) {
-    for (auto& m : almanac.maps) {
-        source = m.lookup(source);
-    }
-    return source;
+        return min_location;
+    });
+    return mins.empty() ? std::numeric_limits<uint64_t>::max() : *std::min_element(mins.cbegin(), mins.cend());
 }
 
-uint64_t forward_lookup(const almanac_t& almanac) {
+// Smallest location over the seed ranges, read off the composed map.
+uint64_t composed_min(const almanac_t& almanac, const range_set_t& seed_ranges) {
     uint64_t min_location = std::numeric_limits<uint64_t>::max();
-    for (auto& seed_range : almanac.seeds) {
-        for (auto s = seed_range.start; s < seed_range.end; s++) {
-            if (auto source = lookup_location(almanac, s); source < min_location) {
-                min_location = source;
-            }
-        }
+    for (const auto& seeds : seed_ranges) {
+        min_location = std::min(min_location, almanac.seed_to_location.min_lookup(seeds));
     }
     return min_location;
 }
 
-uint64_t reverse_lookup(const almanac_t& almanac) {
-    std::map<uint64_t, range_entry_t> location_map = almanac.maps.back().reverse_map();
-
-    for (const auto& e : location_map) {
-        auto& location_source_range = e.second.source_range();
-
-        std::vector<range_t> source_ranges = {location_source_range};
-        for (auto rit = almanac.maps.crbegin() + 1; rit != almanac.maps.crend(); ++rit) {
-            std::vector<range_t> ranges;
-            for (auto& r : source_ranges) {
-                auto sr = rit->reverse_lookup(r);
-                for (auto& s : sr) {
-                    ranges.push_back(s);
-                }
-            }
-            source_ranges = ranges;
-        }
-
-        uint64_t min_location = std::numeric_limits<uint64_t>::max();
-        for (auto& seed_range : almanac.seeds) {
-            for (auto& source_range : source_ranges) {
-                if (auto intersection = seed_range.intersect(source_range); !intersection.empty()) {
-                    if (auto loc = lookup_location(almanac, intersection.start); loc < min_location) {
-                        min_location = loc;
-                    }
-                    // TODO: technically, we'd need to check all the intersections for each seed range, but this is
-                    // sufficient to provide the correct solution for the given input.
-                }
-            }
-        }
-        if (min_location != std::numeric_limits<uint64_t>::max()) {
-            return min_location;
-        }
+uint64_t part1(const almanac_t& almanac) {
+    if (almanac.seeds.empty()) {
+        throw advent::io::input_error_t("expected a seeds line with at least one seed");
     }
-    return 0;
-}
+    std::vector<uint64_t> locations(almanac.seeds.size());
+    almanac.seed_to_location.lookup_batch(almanac.seeds.data(), locations.size(), locations.data());
+    auto min_location = *std::min_element(locations.cbegin(), locations.cend());
 
-uint64_t part1(const almanac_t& almanac) {
-    return forward_lookup(almanac);
+    range_set_t seeds;
+    seed_ranges(almanac, false, seeds);
+    assert(min_location == forward_lookup(almanac, seeds));
+    return min_location;
 }
 
-uint64_t part2(almanac_t& almanac) {
-    auto seeds = almanac.seeds;
-    assert(seeds.size() % 2 == 0);
-    almanac.seeds.clear();
+uint64_t part2(const almanac_t& almanac) {
+    range_set_t seeds;
+    seed_ranges(almanac, true, seeds);
+    auto min_location = composed_min(almanac, seeds);
 
-    for (size_t i = 0ul; i < seeds.size(); i += 2ul) {
-        almanac.seeds.emplace_back(range_t{seeds[i].start, seeds[i].start + seeds[i + 1].start});
-    }
-
-    return reverse_lookup(almanac);
+    // propagation needs no composed map, so it checks the composition independently
+    [[maybe_unused]] range_buffers_t buffers;
+    assert(min_location
+           == propagate_min(almanac.maps.data(), almanac.maps.size(), seeds.begin(), seeds.size(), buffers));
+    return min_location;
 }
 
-void parse_line(const std::string& line, almanac_t& almanac) {
+// Reads one line of the almanac into `almanac`; throws io::input_error_t for a line it cannot place.
+void parse_line(std::string_view line, almanac_t& almanac) {
     if (line.empty()) {
         return;
     }
 
-    auto colon_split = advent::strings::split(line, ':');
-    if (colon_split.size() == 2ul) {
-        assert(almanac.seeds.empty());
-        for (auto n : advent::strings::split(colon_split[1], ' ')) {
-            if (!n.empty()) {
-                almanac.seeds.emplace_back(range_t{std::stoull(n), std::stoull(n) + 1ul});
-            }
+    auto end = line.data() + line.size();
+    if (auto colon_pos = line.find(':'); colon_pos != std::string_view::npos && colon_pos + 1ul < line.size()) {
+        if (!almanac.seeds.empty()) {
+            throw advent::io::input_error_t("expected a single seeds line", line);
+        }
+        auto res = advent::numbers::parse_next<uint64_t>(line.data() + colon_pos + 1ul, end);
+        for (; res; res = advent::numbers::parse_next<uint64_t>(res.ptr, end)) {
+            almanac.seeds.push_back(res.value);
+        }
+        // parsing stops at the end of the line, or at anything that is not a number
+        if (res.ec != std::errc::invalid_argument || res.ptr != end) {
+            throw advent::io::input_error_t("expected \"seeds: <numbers>\"", line);
         }
+    } else if (line.find("map:") != std::string_view::npos) {
+        almanac.maps.emplace_back();
     } else {
-        if (line.find("map:") != std::string::npos) {
-            almanac.maps.emplace_back();
-        } else {
-            auto entry = advent::strings::split(line, ' ');
-            assert(entry.size() == 3ul);
-            almanac.maps.back().insert(range_entry_t(std::stoull(entry[1]), std::stoull(entry[0]), std::stoull(entry[2])));
+        if (almanac.maps.empty()) {
+            throw advent::io::input_error_t("map entry before the first map header", line);
+        }
+        auto destination = advent::numbers::parse_next<uint64_t>(line.data(), end);
+        auto source = advent::numbers::parse_next<uint64_t>(destination.ptr, end);
+        auto length = advent::numbers::parse_next<uint64_t>(source.ptr, end);
+        // only spaces may follow the third number
+        auto rest = advent::numbers::parse_next<uint64_t>(length ? length.ptr : end, end);
+        if (!destination || !source || !length || rest.ec != std::errc::invalid_argument || rest.ptr != end) {
+            throw advent::io::input_error_t("expected \"<destination> <source> <length>\"", line);
+        }
+        // neither range may run to or past the top of the value range
+        if (source.value + length.value < source.value || destination.value + length.value < destination.value) {
+            throw advent::io::input_error_t("map entry runs past the largest value", line);
         }
+        almanac.maps.back().insert(range_entry_t(source.value, destination.value, length.value));
     }
 }
 
-void run_solution() {
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day5/input.txt");
-    if (input_file.is_open()) {
-        almanac_t almanac;
-        while (std::getline(input_file, line)) {
-            parse_line(line, almanac);
-        }
-        input_file.close();
+almanac_t parse(std::string_view input) {
+    almanac_t almanac;
+    for (auto line : advent::io::lines_t(input)) {
+        parse_line(line, almanac);
+    }
+    if (almanac.maps.empty()) {
+        throw advent::io::input_error_t("expected at least one map");
+    }
+    for (auto& m : almanac.maps) {
+        m.build();
+    }
+    almanac.seed_to_location = almanac.maps.front();
+    for (auto m = almanac.maps.cbegin() + 1; m != almanac.maps.cend(); ++m) {
+        almanac.seed_to_location = range_map_t::compose(almanac.seed_to_location, *m);
+    }
+    return almanac;
+}
 
-        std::cout << "Part 1: " << part1(almanac) << std::endl;
-        std::cout << "Part 2: " << part2(almanac) << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+// One request line of the query server: `seed N` or `range START LENGTH`.
+struct query_t {
+    enum class kind_t { seed, range, error } kind = kind_t::error;
+    // the seed, or for a range its smallest location
+    uint64_t value = 0ull;
+    const char* error = nullptr;
+};
+
+query_t parse_query(std::string_view line, const range_map_t& seed_to_location) {
+    // tolerate CRLF clients
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1ul);
     }
+    auto end = line.data() + line.size();
+    auto space = std::find(line.data(), end, ' ');
+    std::string_view verb(line.data(), static_cast<size_t>(space - line.data()));
+    auto first = advent::numbers::parse_next<uint64_t>(space, end);
+    if (!first) {
+        return {query_t::kind_t::error, 0ull, "expected 'seed N' or 'range START LENGTH'"};
+    }
+    if (verb == "seed" && first.ptr == end) {
+        return {query_t::kind_t::seed, first.value, nullptr};
+    }
+    auto second = advent::numbers::parse_next<uint64_t>(first.ptr, end);
+    if (verb != "range" || !second || second.ptr != end) {
+        return {query_t::kind_t::error, 0ull, "expected 'seed N' or 'range START LENGTH'"};
+    }
+    if (second.value == 0ull || first.value + second.value < first.value) {
+        return {query_t::kind_t::error, 0ull, "range is empty or runs past the largest seed"};
+    }
+    return {query_t::kind_t::range, seed_to_location.min_lookup(range_t{first.value, first.value + second.value}), nullptr};
 }
 
-int main() {
-    run_solution();
-    return 0;
+// Query server over the composed map: the almanac is parsed and composed once, then each `seed N` is
+// answered with the seed's location and each `range START LENGTH` with the smallest location of its seeds,
+// one line per request and `error ...` for a malformed one. The seeds asked for in one batch are looked up
+// together with a single lookup_batch().
+advent::server::handler_t make_server(std::string_view input) {
+    struct server_state_t {
+        almanac_t almanac;
+        // scratch reused across batches
+        std::vector<query_t> queries;
+        std::vector<uint64_t> seeds;
+    };
+    auto state = std::make_shared<server_state_t>();
+    state->almanac = parse(input);
+
+    return [state](const std::vector<std::string_view>& requests, std::string& responses) {
+        auto& queries = state->queries;
+        auto& seeds = state->seeds;
+        queries.clear();
+        seeds.clear();
+        for (auto line : requests) {
+            queries.push_back(parse_query(line, state->almanac.seed_to_location));
+            if (queries.back().kind == query_t::kind_t::seed) {
+                seeds.push_back(queries.back().value);
+            }
+        }
+        state->almanac.seed_to_location.lookup_batch(seeds.data(), seeds.size(), seeds.data());
+        ADVENT_METRICS_COUNT("day5.server.seed_queries", seeds.size());
+
+        size_t next_seed = 0ul;
+        char number[24];
+        for (const auto& q : queries) {
+            if (q.kind == query_t::kind_t::error) {
+                responses.append("error ").append(q.error).push_back('\n');
+                continue;
+            }
+            auto value = q.kind == query_t::kind_t::seed ? seeds[next_seed++] : q.value;
+            auto res = std::to_chars(number, number + sizeof(number), value);
+            responses.append(number, res.ptr).push_back('\n');
+        }
+    };
 }
+
+} // namespace day5
+
+ADVENT_REGISTER_DAY(5, day5::parse, day5::part1, day5::part2);
+ADVENT_REGISTER_SERVER(5, day5::make_server);
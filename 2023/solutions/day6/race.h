@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include <common/metrics.h>
+
+namespace day6 {
+
+using uint128_t = unsigned __int128;
+
+struct race_t {
+    uint64_t time;
+    uint64_t distance;
+};
+
+// floor(sqrt(n)), exact over the whole 128-bit range. The double estimate is within one of the root while n
+// fits in 64 bits; above that, one Newton step from it lands on the root or one above. A single boundary
+// correction each way then makes it exact, without branches that depend on the data.
+inline uint64_t isqrt(uint128_t n) {
+    constexpr auto max_root = std::numeric_limits<uint64_t>::max();
+    // converting the halves keeps the compiler from calling its generic 128-bit conversion
+    auto high = static_cast<uint64_t>(n >> 64);
+    auto estimate = std::sqrt(static_cast<double>(high) * 0x1.0p64 + static_cast<double>(static_cast<uint64_t>(n)));
+    uint64_t r = estimate >= 0x1.0p64 ? max_root : static_cast<uint64_t>(estimate);
+    if (high != 0ull) {
+        // r >= 2^32 here; near the top of the range the step can overshoot the largest root
+        auto step = (r + n / r) / 2u;
+        r = step > max_root ? max_root : static_cast<uint64_t>(step);
+    }
+    r -= static_cast<uint128_t>(r) * r > n;
+    // (r + 1)^2 would wrap past 2^128 for the largest root, which is always the answer there
+    r += r != max_root && static_cast<uint128_t>(r + 1u) * (r + 1u) <= n;
+    return r;
+}
+
+// Number of whole hold times h that beat the record, h * (time - h) > distance. With k = 2h - time that is
+// k^2 < time^2 - 4 * distance, for k of the same parity as time, so the answer is read off the integer
+// root of the discriminant without any floating point rounding, for every 64-bit time and distance.
+inline uint64_t calc_num_ways(const race_t& race) {
+    ADVENT_METRICS_COUNT("day6.races", 1);
+    auto square = static_cast<uint128_t>(race.time) * race.time;
+    auto record = static_cast<uint128_t>(race.distance) * 4u;
+    if (square <= record) {
+        return 0ull;
+    }
+    auto discriminant = square - record;
+    // largest k with k^2 < discriminant, then down to the parity of time; without a winning k that leaves
+    // k at -1, wrapped, and the count below at 0
+    auto k = isqrt(discriminant);
+    k -= static_cast<uint128_t>(k) * k == discriminant;
+    k -= (k ^ race.time) & 1ull;
+    // k, k - 2, ..., -k
+    return k + 1ull;
+}
+
+} // namespace day6
@@ -1,32 +1,39 @@
-#include <cmath>
-#include <fstream>
-#include <iostream>
-#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
 #include <vector>
 
-#include <common/strings.h>
+#include <common/input_error.h>
+#include <common/line_reader.h>
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/numbers.h>
+#include <common/runner.h>
 
-#include <cassert>
+#include "race.h"
 
-
-struct race_t {
-    uint64_t time;
-    uint64_t distance;
-};
+namespace day6 {
 
 using races_t = std::vector<race_t>;
 
-uint64_t calc_num_ways(const race_t& race) {
-    // -d^2 + t*d -dist = 0
-    auto discriminant = race.time * race.time - 4ul * race.distance;
-    assert(discriminant >= 0);
-    auto start = std::ceil((static_cast<double>(race.time) - std::sqrt(discriminant)) / 2.0);
-    auto last = std::floor((static_cast<double>(race.time) + std::sqrt(discriminant)) / 2.0);
-    return last - start + 1ul;
+// The digits of `b` appended to those of `a`, shifting `a` one decimal place per digit of `b`. Throws
+// io::input_error_t if the result does not fit, as a race of part 2 must.
+uint64_t concat_digits(uint64_t a, uint64_t b) {
+    bool overflow = false;
+    auto rest = b;
+    do {
+        overflow |= __builtin_mul_overflow(a, 10ull, &a);
+        rest /= 10ull;
+    } while (rest != 0ull);
+    overflow |= __builtin_add_overflow(a, b, &a);
+    if (overflow) {
+        throw advent::io::input_error_t("the numbers joined for part 2 do not fit in 64 bits");
+    }
+    return a;
 }
 
 uint64_t part1(const races_t& races) {
-    int result = 1;
+    uint64_t result = 1ull;
     for (const auto& race : races) {
         result *= calc_num_ways(race);
     }
@@ -34,60 +41,79 @@ uint64_t part1(const races_t& races) {
 }
 
 uint64_t part2(const races_t& races) {
-    std::string time_string;
-    std::string distance_string;
-    for (auto& r : races) {
-        time_string += std::to_string(r.time);
-        distance_string += std::to_string(r.distance);
+    race_t race{0ull, 0ull};
+    for (const auto& r : races) {
+        race.time = concat_digits(race.time, r.time);
+        race.distance = concat_digits(race.distance, r.distance);
     }
-    return calc_num_ways(race_t{std::stoul(time_string), std::stoul(distance_string)});
+    return calc_num_ways(race);
 }
 
-void parse_line(const std::string& line, races_t& races) {
-    auto cat_split = advent::strings::split(line, ':');
-    assert(cat_split.size() == 2ul);
-    auto nums = advent::strings::split(cat_split[1], ' ', true);
-    assert(!nums.empty());
-    if (cat_split[0].find("Time") != std::string::npos) {
-        assert(races.empty());
-        for (auto& n : nums) {
-            if (!n.empty()) {
-                races.emplace_back(race_t{std::stoull(n), 0});
-            }
+// Reads the "Time:" line, then the "Distance:" line with one distance per time, setting `have_distances`
+// once it has; throws io::input_error_t for anything else.
+void parse_line(std::string_view line, races_t& races, bool& have_distances) {
+    if (line.empty()) {
+        return;
+    }
+    auto colon_pos = line.find(':');
+    if (colon_pos == std::string_view::npos) {
+        throw advent::io::input_error_t("expected \"Time: <numbers>\" or \"Distance: <numbers>\"", line);
+    }
+    auto category = line.substr(0, colon_pos);
+    auto is_time = category.find("Time") != std::string_view::npos;
+    auto is_distance = !is_time && category.find("Distance") != std::string_view::npos;
+    auto in_order = is_time ? races.empty() : is_distance && !races.empty() && !have_distances;
+    if (!in_order) {
+        throw advent::io::input_error_t("expected one \"Time:\" line, then one \"Distance:\" line", line);
+    }
+
+    auto end = line.data() + line.size();
+    size_t i = 0ul;
+    auto res = advent::numbers::parse_next<uint64_t>(line.data() + colon_pos + 1ul, end);
+    for (; res; res = advent::numbers::parse_next<uint64_t>(res.ptr, end), i++) {
+        if (is_time) {
+            races.emplace_back(race_t{res.value, 0});
+        } else if (i < races.size()) {
+            races[i].distance = res.value;
         }
-    } else {
-        assert(cat_split[0].find("Distance") != std::string::npos);
-        assert(!races.empty());
-        size_t i = 0ul;
-        for (auto& n : nums) {
-            if (!n.empty()) {
-                assert(i < races.size());
-                races[i].distance = std::stoull(n);
-                i++;
-            }
+    }
+    // parsing stops at the end of the line, or at anything that is not a number
+    if (res.ec != std::errc::invalid_argument || res.ptr != end || i == 0ul) {
+        throw advent::io::input_error_t("expected a list of numbers", line);
+    }
+    if (!is_time) {
+        if (i != races.size()) {
+            throw advent::io::input_error_t("expected one distance per time", line);
         }
+        have_distances = true;
     }
 }
 
-void run_solution() {
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day6/input.txt");
-    if (input_file.is_open()) {
-        races_t races;
-        while (std::getline(input_file, line)) {
-            parse_line(line, races);
-        }
-        input_file.close();
-
-        assert(races.back().distance != 0);
-        std::cout << "Part 1: " << part1(races) << std::endl;
-        std::cout << "Part 2: " << part2(races) << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+races_t parse(std::string_view input) {
+    races_t races;
+    bool have_distances = false;
+    for (auto line : advent::io::lines_t(input)) {
+        parse_line(line, races, have_distances);
     }
+    if (!have_distances) {
+        throw advent::io::input_error_t("expected a \"Time:\" and a \"Distance:\" line");
+    }
+    return races;
 }
 
-int main() {
-    run_solution();
-    return 0;
+std::pair<uint64_t, uint64_t> solve_stream(advent::io::line_reader_t& lines) {
+    races_t races;
+    bool have_distances = false;
+    for (std::string_view line; lines.next(line);) {
+        parse_line(line, races, have_distances);
+    }
+    if (!have_distances) {
+        throw advent::io::input_error_t("expected a \"Time:\" and a \"Distance:\" line");
+    }
+    return {part1(races), part2(races)};
 }
+
+} // namespace day6
+
+ADVENT_REGISTER_DAY(6, day6::parse, day6::part1, day6::part2);
+ADVENT_REGISTER_STREAM(6, day6::solve_stream);
@@ -1,12 +1,20 @@
-#include <fstream>
-#include <iostream>
-#include <set>
+#include <algorithm>
 #include <string>
-
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <common/input_error.h>
+#include <common/line_reader.h>
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/numbers.h>
+#include <common/runner.h>
 #include <common/strings.h>
 
 #include <cassert>
 
+namespace day7 {
 
 enum class hand_type_t {
     unknown = 0,
@@ -19,7 +27,8 @@ enum class hand_type_t {
     five_kind,
 };
 
-hand_type_t determine_hand_type(const std::string& cards, bool enable_jokers) {
+hand_type_t determine_hand_type(std::string_view cards, bool enable_jokers) {
+    ADVENT_METRICS_COUNT("day7.hand_types", 1);
     std::vector<bool> visited(cards.size(), false);
     std::vector<int> all_matches;
     int num_jokers = 0;
@@ -110,136 +119,107 @@ hand_type_t determine_hand_type(const std::string& cards, bool enable_jokers) {
     return hand_type;
 }
 
-bool compare_cards(char left, char right, bool enable_jokers) {
-    auto is_num = [](char c) { return c >= '0' && c <= '9'; };
-    auto left_is_num = is_num(left);
-    auto right_is_num = is_num(right);
-
-    if (enable_jokers) {
-        if (right == 'J') {
-            return false;
-        } else if (left == 'J') {
-            return true;
-        }
-    }
-
-    if (left_is_num && right_is_num) {
-        return left < right;
-    } else if (left_is_num) {
-        return true;
-    } else if (right_is_num) {
-        return false;
-    } else {
-        switch (left) {
-        case 'A':
-            return false;
-        case 'K':
-            return right == 'A' || right == 'K';
-        case 'Q':
-            return right == 'A' || right == 'K' || right == 'Q';
-        case 'J':
-            return right != 'T' && right != 'J';
-        case 'T':
-            return right != 'T';
-        default:
-            assert(false);
-        }
-        return false;
+// Strength of a card within a hand: 2..9 by face value, then T, J, Q, K, A; with jokers enabled J is the
+// weakest card.
+uint32_t card_strength(char card, bool enable_jokers) {
+    switch (card) {
+    case 'A':
+        return 14u;
+    case 'K':
+        return 13u;
+    case 'Q':
+        return 12u;
+    case 'J':
+        return enable_jokers ? 1u : 11u;
+    case 'T':
+        return 10u;
+    default:
+        assert(card >= '2' && card <= '9');
+        return static_cast<uint32_t>(card - '0');
     }
 }
 
-class hand_t {
-public:
-    hand_t(const std::string& cards, int bid, bool enable_jokers)
-        : _cards(cards), _bid(bid), _enable_jokers(enable_jokers) {
-            assert(_cards.size() == 5ul);
-        }
-
-    bool operator==(const hand_t& other) const {
-        return other._cards == _cards && other._bid == _bid;
-    }
-
-    bool operator<(const hand_t& other) const {
-        if (static_cast<std::underlying_type_t<hand_type_t>>(hand_type())
-            == static_cast<std::underlying_type_t<hand_type_t>>(other.hand_type())) {
-            for (size_t i = 0ul; i < _cards.size(); i++) {
-                if (_cards[i] != other._cards[i]) {
-                    return compare_cards(_cards[i], other._cards[i], _enable_jokers);
-                }
-            }
-            assert(false);
-        } else {
-            return static_cast<std::underlying_type_t<hand_type_t>>(hand_type())
-                < static_cast<std::underlying_type_t<hand_type_t>>(other.hand_type());
-        }
-    }
-
-    hand_type_t hand_type() const {
-        if (_hand_type == hand_type_t::unknown) {
-            const_cast<hand_t*>(this)->_hand_type = determine_hand_type(_cards, _enable_jokers);
-        }
-        return _hand_type;
+// The hand type followed by the strength of each card, 4 bits apiece, so comparing keys ranks hands
+// exactly as the puzzle does.
+uint32_t hand_key(std::string_view cards, bool enable_jokers) {
+    assert(cards.size() == 5ul);
+    auto key = static_cast<uint32_t>(determine_hand_type(cards, enable_jokers));
+    for (auto c : cards) {
+        key = (key << 4) | card_strength(c, enable_jokers);
     }
+    return key;
+}
 
-    int winnings(int rank) const { return _bid * rank; }
-    const std::string& cards() const { return _cards; }
-    int bid() const { return _bid; }
-
-private:
-    std::string _cards;
-    int _bid;
-    hand_type_t _hand_type = hand_type_t::unknown;
-    bool _enable_jokers;
+// Hands are packed as (key << 32) | bid, 8 bytes per hand and part, so sorting a vector ranks the hands.
+struct hands_t {
+    std::vector<uint64_t> plain;
+    std::vector<uint64_t> jokers;
 };
 
-using hands_t = std::set<hand_t>;
-
-uint64_t part1(const hands_t& hands) {
+uint64_t total_winnings(const std::vector<uint64_t>& ranked_hands) {
     uint64_t total_winnings = 0;
-    int rank = 1;
-    for (auto& hand : hands) {
-        total_winnings += hand.winnings(rank++);
+    uint64_t rank = 1;
+    for (auto hand : ranked_hands) {
+        total_winnings += (hand & 0xffffffffull) * rank++;
     }
     return total_winnings;
 }
 
-uint64_t part2(const hands_t& hands_) {
-    hands_t hands;
-    for (const auto& hand : hands_) {
-        hands.emplace(hand.cards(), hand.bid(), true);
+uint64_t part1(const hands_t& hands) {
+    return total_winnings(hands.plain);
+}
+
+uint64_t part2(const hands_t& hands) {
+    return total_winnings(hands.jokers);
+}
+
+void parse_line(std::string_view line, hands_t& hands) {
+    // a blank line, typically the last one, holds no hand
+    if (line.empty()) {
+        return;
     }
-    uint64_t total_winnings = 0;
-    int rank = 1;
-    for (auto& hand : hands) {
-        total_winnings += hand.winnings(rank++);
+    auto split = advent::strings::tokenize(line, " ", false, true);
+    auto split_itr = split.begin();
+    std::string_view fields[2];
+    size_t num_fields = 0ul;
+    for (; split_itr != split.end() && num_fields < 2ul; ++split_itr) {
+        fields[num_fields++] = *split_itr;
     }
-    return total_winnings;
+    auto cards = fields[0];
+    auto bid = advent::numbers::parse<uint32_t>(fields[1]);
+    if (num_fields != 2ul || split_itr != split.end() || cards.size() != 5ul
+        || cards.find_first_not_of("23456789TJQKA") != std::string_view::npos || !bid
+        || bid.ptr != fields[1].data() + fields[1].size()) {
+        throw advent::io::input_error_t("expected a hand of five cards and a bid", line);
+    }
+    hands.plain.push_back((static_cast<uint64_t>(hand_key(cards, false)) << 32) | bid.value);
+    hands.jokers.push_back((static_cast<uint64_t>(hand_key(cards, true)) << 32) | bid.value);
 }
 
-hand_t parse_line(const std::string& line) {
-    auto split = advent::strings::split(line, ' ');
-    assert(split.size() == 2ul);
-    return hand_t(split[0], std::stoi(split[1]), false);
+void rank_hands(hands_t& hands) {
+    std::sort(hands.plain.begin(), hands.plain.end());
+    std::sort(hands.jokers.begin(), hands.jokers.end());
 }
 
-void run_solution() {
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day7/input.txt");
-    if (input_file.is_open()) {
-        hands_t hands;
-        while (std::getline(input_file, line)) {
-            hands.insert(parse_line(line));
-        }
-        input_file.close();
-
-        std::cout << "Part 1: " << part1(hands) << std::endl;
-        std::cout << "Part 2: " << part2(hands) << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+hands_t parse(std::string_view input) {
+    hands_t hands;
+    for (auto line : advent::io::lines_t(input)) {
+        parse_line(line, hands);
     }
+    rank_hands(hands);
+    return hands;
 }
 
-int main() {
-    run_solution();
-    return 0;
+std::pair<uint64_t, uint64_t> solve_stream(advent::io::line_reader_t& lines) {
+    hands_t hands;
+    for (std::string_view line; lines.next(line);) {
+        parse_line(line, hands);
+    }
+    rank_hands(hands);
+    return {part1(hands), part2(hands)};
 }
+
+} // namespace day7
+
+ADVENT_REGISTER_DAY(7, day7::parse, day7::part1, day7::part2);
+ADVENT_REGISTER_STREAM(7, day7::solve_stream);
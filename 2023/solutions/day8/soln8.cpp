@@ -1,17 +1,20 @@
 #include <algorithm>
 #include <array>
-#include <fstream>
-#include <iostream>
 #include <numeric>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <common/mapped_file.h>
+#include <common/metrics.h>
+#include <common/runner.h>
 #include <common/strings.h>
 
 #include <cassert>
 
+namespace day8 {
 
 using seq_t = std::vector<size_t>;
 
@@ -25,6 +28,11 @@ struct nodes_t {
     std::vector<node_t*> starting_locations;
 };
 
+struct input_t {
+    seq_t seq;
+    nodes_t nodes;
+};
+
 struct loc_t {
     loc_t(node_t* node_, size_t seq_) : node(node_), seq(seq_) {}
     bool operator==(const loc_t& other) const { return other.node == node && other.seq == seq; }
@@ -32,20 +40,18 @@ struct loc_t {
     size_t seq;
 };
 
-namespace std {
-template <>
-struct hash<loc_t> {
+struct loc_hash_t {
     std::size_t operator()(const loc_t& k) const {
-        return hash<uintptr_t>()((uintptr_t)k.node) ^ hash<size_t>()(k.seq);
+        return std::hash<uintptr_t>()((uintptr_t)k.node) ^ std::hash<size_t>()(k.seq);
     }
 };
-}
 
 class loop_detector_t {
 public:
     loop_detector_t() = default;
 
     size_t check(node_t* node, size_t seq_index, size_t cur_step) {
+        ADVENT_METRICS_COUNT("day8.loop_detector.check", 1);
         if (auto insert_res = _visited.emplace(loc_t(node, seq_index), cur_step); insert_res.second) {
             return cur_step;
         } else {
@@ -54,10 +60,12 @@ public:
     }
 
 private:
-    std::unordered_map<loc_t, size_t> _visited;
+    std::unordered_map<loc_t, size_t, loc_hash_t> _visited;
 };
 
-uint64_t part1(const seq_t& seq, const nodes_t& nodes) {
+uint64_t part1(const input_t& input) {
+    const auto& seq = input.seq;
+    const auto& nodes = input.nodes;
     size_t num_steps = 0;
     size_t seq_index = 0;
     const node_t* cur = &nodes.full_map.find("AAA")->second;
@@ -67,10 +75,13 @@ uint64_t part1(const seq_t& seq, const nodes_t& nodes) {
         num_steps++;
         seq_index = num_steps % seq.size();
     } while (cur != dest);
+    ADVENT_METRICS_COUNT("day8.steps", num_steps);
     return num_steps;
 }
 
-uint64_t part2(const seq_t& seq, const nodes_t& nodes) {
+uint64_t part2(const input_t& input) {
+    const auto& seq = input.seq;
+    const auto& nodes = input.nodes;
     size_t total_num_steps = 1ul;
     size_t seq_index = 0ul;
 
@@ -86,27 +97,35 @@ uint64_t part2(const seq_t& seq, const nodes_t& nodes) {
             steps_last_visited = loop_detector.check(cur, seq_index, num_steps);
         }
 
+        ADVENT_METRICS_RECORD("day8.cycle_length", num_steps - steps_last_visited);
         total_num_steps = std::lcm(total_num_steps, num_steps - steps_last_visited);
     }
 
     return total_num_steps;
 }
 
-void parse_line(const std::string& line, seq_t& seq, nodes_t& nodes) {
-    auto split = advent::strings::split(line, '=', true);
-    if (split.size() == 1ul && !split.front().empty()) {
+void parse_line(std::string_view line, seq_t& seq, nodes_t& nodes) {
+    auto split = advent::strings::tokenize(line, "=", true, true);
+    auto split_itr = split.begin();
+    if (split_itr == split.end()) {
+        return;
+    }
+
+    auto first = *split_itr++;
+    if (split_itr == split.end()) {
         assert(seq.empty());
-        for (auto c : split.front()) {
+        for (auto c : first) {
             assert(c == 'L' || c == 'R');
             seq.push_back(c == 'R');
         }
-    } else if (!split.empty()) {
-        assert(split.size() == 2ul);
-        auto node_name = split.front();
-        auto split_neighbors = advent::strings::split(split[1], ',', true);
-        assert(split_neighbors.size() == 2ul);
-        auto left_node_name = split_neighbors[0].substr(1, 4);
-        auto right_node_name = split_neighbors[1].substr(0, 3);
+    } else {
+        auto node_name = first;
+        auto split_neighbors = advent::strings::tokenize(*split_itr, "(), ", false, true);
+        auto neighbor_itr = split_neighbors.begin();
+        auto left_node_name = *neighbor_itr++;
+        assert(neighbor_itr != split_neighbors.end());
+        auto right_node_name = *neighbor_itr;
+        assert(left_node_name.size() == 3ul && right_node_name.size() == 3ul);
         auto node_insert = nodes.full_map.emplace(node_name, node_t{});
         node_insert.first->second.neighbors[0] = &nodes.full_map.emplace(left_node_name, node_t{}).first->second;
         node_insert.first->second.neighbors[1] = &nodes.full_map.emplace(right_node_name, node_t{}).first->second;
@@ -124,27 +143,16 @@ void parse_line(const std::string& line, seq_t& seq, nodes_t& nodes) {
     }
 }
 
-void run_solution() {
-    std::string line;
-    std::ifstream input_file("../../../../2023/solutions/day8/input.txt");
-    if (input_file.is_open()) {
-        seq_t seq;
-        nodes_t nodes;
-        while (std::getline(input_file, line)) {
-            parse_line(line, seq, nodes);
-        }
-        input_file.close();
-
-        assert(nodes.full_map.find("AAA") != nodes.full_map.end());
-        assert(nodes.full_map.find("ZZZ") != nodes.full_map.end());
-        std::cout << "Part 1: " << part1(seq, nodes) << std::endl;
-        std::cout << "Part 2: " << part2(seq, nodes) << std::endl;
-    } else {
-        std::cout << "Cannot open input file" << std::endl;
+input_t parse(std::string_view input) {
+    input_t parsed;
+    for (auto line : advent::io::lines_t(input)) {
+        parse_line(line, parsed.seq, parsed.nodes);
     }
+    assert(parsed.nodes.full_map.find("AAA") != parsed.nodes.full_map.end());
+    assert(parsed.nodes.full_map.find("ZZZ") != parsed.nodes.full_map.end());
+    return parsed;
 }
 
-int main() {
-    run_solution();
-    return 0;
-}
+} // namespace day8
+
+ADVENT_REGISTER_DAY(8, day8::parse, day8::part1, day8::part2);
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <cassert>
+
+#include "input_error.h"
+#include "mapped_file.h"
+
+namespace advent {
+namespace grid {
+
+struct offset_t {
+    int row;
+    int column;
+};
+
+constexpr std::array<offset_t, 4> neighbors4 = {{
+    {-1, 0}, {0, -1}, {0, 1}, {1, 0},
+}};
+
+// Row by row, left to right.
+constexpr std::array<offset_t, 8> neighbors8 = {{
+    {-1, -1}, {-1, 0}, {-1, 1},
+    {0, -1}, {0, 1},
+    {1, -1}, {1, 0}, {1, 1},
+}};
+
+// Row-major grid in one contiguous buffer, surrounded by a one-cell border filled with a sentinel value.
+// Every interior cell therefore has all eight neighbors in the buffer, and neighbor access is a fixed
+// index offset with no bounds tests. Cells are addressed either by (row, column) over the interior, with
+// -1 and rows()/columns() reaching the border, or by the flat index() used with offset().
+template <typename T>
+class padded_grid_t {
+public:
+    padded_grid_t() = default;
+
+    padded_grid_t(size_t rows, size_t columns, T border)
+        : _rows(rows), _columns(columns), _stride(columns + 2ul), _cells((rows + 2ul) * _stride, border) {}
+
+    // One row per line, as wide as the first; blank lines may only trail the grid. Throws
+    // io::input_error_t for a row of another width.
+    static padded_grid_t from_lines(std::string_view input, T border) {
+        size_t rows = 0ul, columns = 0ul;
+        bool blank = false;
+        for (auto line : io::lines_t(input)) {
+            if (line.empty()) {
+                blank = true;
+                continue;
+            }
+            if (rows == 0ul) {
+                columns = line.size();
+            }
+            if (blank) {
+                throw io::input_error_t("unexpected blank line before grid row", line);
+            }
+            if (line.size() != columns) {
+                throw io::input_error_t("expected every grid row to be as wide as the first", line);
+            }
+            rows++;
+        }
+
+        padded_grid_t grid(rows, columns, border);
+        size_t row = 0ul;
+        for (auto line : io::lines_t(input)) {
+            if (row == rows) {
+                break;
+            }
+            auto cell = grid.index(row++, 0ul);
+            for (auto c : line) {
+                grid._cells[cell++] = static_cast<T>(c);
+            }
+        }
+        return grid;
+    }
+
+    size_t rows() const { return _rows; }
+    size_t columns() const { return _columns; }
+    // distance between vertically adjacent cells in the flat buffer
+    size_t stride() const { return _stride; }
+    // number of cells including the border, the range of index()
+    size_t size() const { return _cells.size(); }
+
+    size_t index(ptrdiff_t row, ptrdiff_t column) const {
+        assert(row >= -1 && row <= static_cast<ptrdiff_t>(_rows));
+        assert(column >= -1 && column <= static_cast<ptrdiff_t>(_columns));
+        return static_cast<size_t>((row + 1) * static_cast<ptrdiff_t>(_stride) + column + 1);
+    }
+    ptrdiff_t offset(const offset_t& o) const { return o.row * static_cast<ptrdiff_t>(_stride) + o.column; }
+
+    // flat offsets of a neighbor table for this grid's stride
+    template <size_t N>
+    std::array<ptrdiff_t, N> offsets(const std::array<offset_t, N>& table) const {
+        std::array<ptrdiff_t, N> result{};
+        for (size_t i = 0ul; i < N; i++) {
+            result[i] = offset(table[i]);
+        }
+        return result;
+    }
+
+    T& operator[](size_t index) { return _cells[index]; }
+    const T& operator[](size_t index) const { return _cells[index]; }
+    T& operator()(ptrdiff_t row, ptrdiff_t column) { return _cells[index(row, column)]; }
+    const T& operator()(ptrdiff_t row, ptrdiff_t column) const { return _cells[index(row, column)]; }
+
+    T* data() { return _cells.data(); }
+    const T* data() const { return _cells.data(); }
+
+private:
+    size_t _rows = 0ul;
+    size_t _columns = 0ul;
+    size_t _stride = 0ul;
+    std::vector<T> _cells;
+};
+
+// Packed per-cell flags over the flat indices of a padded_grid_t, e.g. for visited sets.
+class bitset_t {
+public:
+    bitset_t() = default;
+    explicit bitset_t(size_t size) : _size(size), _words((size + 63ul) / 64ul, 0ull) {}
+
+    template <typename T>
+    explicit bitset_t(const padded_grid_t<T>& grid) : bitset_t(grid.size()) {}
+
+    bool test(size_t i) const {
+        assert(i < _size);
+        return (_words[i >> 6] >> (i & 63ul)) & 1ull;
+    }
+    void set(size_t i) {
+        assert(i < _size);
+        _words[i >> 6] |= 1ull << (i & 63ul);
+    }
+    void reset(size_t i) {
+        assert(i < _size);
+        _words[i >> 6] &= ~(1ull << (i & 63ul));
+    }
+    void clear() { std::fill(_words.begin(), _words.end(), 0ull); }
+
+    size_t size() const { return _size; }
+
+private:
+    size_t _size = 0ul;
+    std::vector<uint64_t> _words;
+};
+
+} // namespace grid
+} // namespace advent
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace advent {
+namespace io {
+
+// Thrown by a parser for input it cannot make sense of, in every build type; the runner reports it and
+// fails the day instead of computing an answer from a misread input.
+class input_error_t : public std::runtime_error {
+public:
+    // for a problem with the input as a whole rather than with one line of it
+    explicit input_error_t(std::string_view what) : std::runtime_error(std::string(what)) {}
+    input_error_t(std::string_view what, std::string_view line)
+        : std::runtime_error(std::string(what) + ": \"" + std::string(line.substr(0ul, max_quoted)) + "\"") {}
+
+private:
+    // long lines are cut short in the message
+    static constexpr size_t max_quoted = 80ul;
+};
+
+} // namespace io
+} // namespace advent
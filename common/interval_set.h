@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+
+#include <cassert>
+
+#include "metrics.h"
+
+namespace advent {
+namespace intervals {
+
+template <typename T>
+struct interval_t {
+    T start;
+    T end; // exclusive
+
+    bool contains(T v) const {
+        return v >= start && v < end;
+    }
+
+    // the overlap of the two intervals, or an empty interval
+    interval_t intersect(const interval_t& other) const {
+        auto s = std::max(start, other.start);
+        auto e = std::min(end, other.end);
+        return s < e ? interval_t{s, e} : interval_t{s, s};
+    }
+
+    bool empty() const { return start >= end; }
+};
+
+// Set of half-open intervals held in a small inline buffer, moving to the heap only once it outgrows
+// `InlineCapacity`. Storage is never given back: clear() keeps the capacity, so a set reused across
+// queries stops allocating after the first few. push_back() appends without ordering and normalize() sorts
+// and merges in place. Sets are neither copied nor moved; alternate between two with interval_buffers_t
+// instead.
+template <typename T, size_t InlineCapacity = 16ul>
+class interval_set_t {
+public:
+    using value_type = interval_t<T>;
+
+    interval_set_t() = default;
+    interval_set_t(const interval_set_t&) = delete;
+    interval_set_t& operator=(const interval_set_t&) = delete;
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0ul; }
+    size_t capacity() const { return _heap ? _capacity : InlineCapacity; }
+
+    const value_type* begin() const { return data(); }
+    const value_type* end() const { return data() + _size; }
+    const value_type& operator[](size_t i) const { return data()[i]; }
+    const value_type& front() const { return data()[0]; }
+
+    void clear() { _size = 0ul; }
+
+    void push_back(const value_type& interval) {
+        if (_size == capacity()) {
+            grow();
+        }
+        data()[_size++] = interval;
+    }
+
+    // Sorts by start, merges intervals that overlap or touch and drops empty ones.
+    void normalize() {
+        auto d = data();
+        std::sort(d, d + _size, [](const value_type& a, const value_type& b) { return a.start < b.start; });
+        size_t merged = 0ul;
+        for (size_t i = 0ul; i < _size; i++) {
+            if (d[i].empty()) {
+                continue;
+            }
+            if (merged != 0ul && d[i].start <= d[merged - 1ul].end) {
+                d[merged - 1ul].end = std::max(d[merged - 1ul].end, d[i].end);
+            } else {
+                d[merged++] = d[i];
+            }
+        }
+        _size = merged;
+    }
+
+private:
+    value_type* data() { return _heap ? _heap.get() : _inline.data(); }
+    const value_type* data() const { return _heap ? _heap.get() : _inline.data(); }
+
+    void grow() {
+        ADVENT_METRICS_COUNT("interval_set.grow", 1);
+        auto capacity = 2ul * this->capacity();
+        auto heap = std::make_unique<value_type[]>(capacity);
+        std::copy(data(), data() + _size, heap.get());
+        _heap = std::move(heap);
+        _capacity = capacity;
+    }
+
+    std::array<value_type, InlineCapacity> _inline;
+    std::unique_ptr<value_type[]> _heap;
+    size_t _capacity = 0ul;
+    size_t _size = 0ul;
+};
+
+// Two interval sets used in turn: a step reads current() and writes next(), then flip() makes its output
+// the next step's input without copying either set.
+template <typename T, size_t InlineCapacity = 16ul>
+class interval_buffers_t {
+public:
+    using set_type = interval_set_t<T, InlineCapacity>;
+
+    set_type& current() { return _sets[_current]; }
+    set_type& next() { return _sets[_current ^ 1ul]; }
+    void flip() { _current ^= 1ul; }
+
+private:
+    std::array<set_type, 2> _sets;
+    size_t _current = 0ul;
+};
+
+} // namespace intervals
+} // namespace advent
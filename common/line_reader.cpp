@@ -0,0 +1,91 @@
+#include "line_reader.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace advent {
+namespace io {
+
+line_reader_t::line_reader_t(const std::string& path, size_t buffer_size)
+    : _buffer(new char[buffer_size]), _capacity(buffer_size) {
+    if (path == "-") {
+        _fd = STDIN_FILENO;
+        return;
+    }
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd >= 0) {
+        _owns_fd = true;
+        ::posix_fadvise(_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+}
+
+line_reader_t::~line_reader_t() {
+    if (_owns_fd) {
+        ::close(_fd);
+    }
+}
+
+bool line_reader_t::next(std::string_view& line) {
+    size_t scanned = _begin;
+    while (true) {
+        auto newline = static_cast<const char*>(std::memchr(_buffer.get() + scanned, '\n', _end - scanned));
+        if (newline != nullptr) {
+            line = std::string_view(_buffer.get() + _begin, newline - (_buffer.get() + _begin));
+            _begin = newline - _buffer.get() + 1ul;
+            return true;
+        }
+        if (_eof) {
+            if (_begin == _end) {
+                return false;
+            }
+            // last line without a trailing newline
+            line = std::string_view(_buffer.get() + _begin, _end - _begin);
+            _begin = _end;
+            return true;
+        }
+        // nothing before _end holds a newline, so resume scanning there after the refill
+        scanned = _end - _begin;
+        fill();
+    }
+}
+
+void line_reader_t::fill() {
+    if (_fd < 0) {
+        _eof = true;
+        return;
+    }
+
+    // move the partial line to the front, and only grow when a single line fills the whole buffer
+    if (_begin > 0ul) {
+        std::memmove(_buffer.get(), _buffer.get() + _begin, _end - _begin);
+        _end -= _begin;
+        _begin = 0ul;
+    }
+    if (_end == _capacity) {
+        std::unique_ptr<char[]> grown(new char[_capacity * 2ul]);
+        std::memcpy(grown.get(), _buffer.get(), _end);
+        _buffer = std::move(grown);
+        _capacity *= 2ul;
+    }
+
+    while (true) {
+        auto n = ::read(_fd, _buffer.get() + _end, _capacity - _end);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            _failed = n < 0;
+            _eof = true;
+            return;
+        }
+        _end += static_cast<size_t>(n);
+        _bytes_read += static_cast<size_t>(n);
+        return;
+    }
+}
+
+} // namespace io
+} // namespace advent
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace advent {
+namespace io {
+
+// Reads '\n' separated lines from a file or pipe through a fixed-size buffer, so arbitrarily large inputs
+// can be processed in memory bounded by the buffer (or the longest line, if that is bigger). Lines follow
+// the same rules as lines_t.
+class line_reader_t {
+public:
+    // A path of "-" reads standard input.
+    explicit line_reader_t(const std::string& path, size_t buffer_size = 64ul * 1024ul);
+    line_reader_t(const line_reader_t&) = delete;
+    line_reader_t& operator=(const line_reader_t&) = delete;
+    ~line_reader_t();
+
+    bool is_open() const { return _fd >= 0; }
+    // true if reading stopped because of an I/O error rather than end of input
+    bool failed() const { return _failed; }
+
+    // Stores the next line in `line` and returns true, or returns false at the end of the input. The view
+    // is only valid until the next call.
+    bool next(std::string_view& line);
+
+    size_t bytes_read() const { return _bytes_read; }
+    size_t buffer_size() const { return _capacity; }
+
+private:
+    void fill();
+
+    int _fd = -1;
+    bool _owns_fd = false;
+    std::unique_ptr<char[]> _buffer;
+    size_t _capacity = 0ul;
+    size_t _begin = 0ul;
+    size_t _end = 0ul;
+    size_t _bytes_read = 0ul;
+    bool _eof = false;
+    bool _failed = false;
+};
+
+} // namespace io
+} // namespace advent
@@ -0,0 +1,121 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace advent {
+namespace io {
+
+void lines_t::iterator::advance() {
+    if (_next == nullptr || _next == _end) {
+        _next = nullptr;
+        _end = nullptr;
+        _line = std::string_view();
+        return;
+    }
+
+    auto newline = static_cast<const char*>(std::memchr(_next, '\n', _end - _next));
+    if (newline == nullptr) {
+        _line = std::string_view(_next, _end - _next);
+        _next = _end;
+    } else {
+        _line = std::string_view(_next, newline - _next);
+        _next = newline + 1;
+    }
+}
+
+mapped_file_t::mapped_file_t(const std::string& path) {
+    if (path == "-") {
+        read_fd(STDIN_FILENO);
+        return;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            _is_open = true;
+        } else {
+            auto size = static_cast<size_t>(st.st_size);
+            void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                ::madvise(mapping, size, MADV_SEQUENTIAL);
+                _mapping = mapping;
+                _mapping_size = size;
+                _data = std::string_view(static_cast<const char*>(mapping), size);
+                _is_open = true;
+            }
+        }
+    }
+
+    if (!_is_open) {
+        read_fd(fd);
+    }
+    ::close(fd);
+}
+
+mapped_file_t::mapped_file_t(mapped_file_t&& other) noexcept {
+    *this = std::move(other);
+}
+
+mapped_file_t& mapped_file_t::operator=(mapped_file_t&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        _mapping = std::exchange(other._mapping, nullptr);
+        _mapping_size = std::exchange(other._mapping_size, 0ul);
+        _buffer = std::move(other._buffer);
+        _data = _mapping ? other._data : std::string_view(_buffer);
+        _is_open = std::exchange(other._is_open, false);
+        other._data = std::string_view();
+    }
+    return *this;
+}
+
+mapped_file_t::~mapped_file_t() {
+    unmap();
+}
+
+void mapped_file_t::read_fd(int fd) {
+    constexpr size_t chunk_size = 1ul << 16;
+    _buffer.clear();
+    size_t size = 0ul;
+    while (true) {
+        _buffer.resize(size + chunk_size);
+        auto n = ::read(fd, _buffer.data() + size, chunk_size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _buffer.clear();
+            return;
+        }
+        if (n == 0) {
+            break;
+        }
+        size += static_cast<size_t>(n);
+    }
+    _buffer.resize(size);
+    _data = std::string_view(_buffer);
+    _is_open = true;
+}
+
+void mapped_file_t::unmap() {
+    if (_mapping) {
+        ::munmap(_mapping, _mapping_size);
+        _mapping = nullptr;
+        _mapping_size = 0ul;
+    }
+}
+
+} // namespace io
+} // namespace advent
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace advent {
+namespace io {
+
+// Forward range over the '\n' separated lines of a buffer. Lines are views into the buffer and do not
+// include the newline; like std::getline, a trailing newline does not produce an extra empty line.
+class lines_t {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() = default;
+
+        reference operator*() const { return _line; }
+        pointer operator->() const { return &_line; }
+
+        iterator& operator++() {
+            advance();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto tmp = *this;
+            advance();
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const { return _next == other._next && _line.data() == other._line.data(); }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class lines_t;
+
+        iterator(const char* begin, const char* end) : _next(begin), _end(end) { advance(); }
+
+        void advance();
+
+        const char* _next = nullptr;
+        const char* _end = nullptr;
+        std::string_view _line;
+    };
+
+    explicit lines_t(std::string_view buffer) : _buffer(buffer) {}
+
+    iterator begin() const { return iterator(_buffer.data(), _buffer.data() + _buffer.size()); }
+    iterator end() const { return iterator(); }
+
+private:
+    std::string_view _buffer;
+};
+
+// Read-only view of a whole input file. Regular files are mmap'd; anything that cannot be mapped
+// (pipes, character devices, stdin) is read into an owned buffer instead.
+class mapped_file_t {
+public:
+    // A path of "-" reads standard input.
+    explicit mapped_file_t(const std::string& path);
+    mapped_file_t(mapped_file_t&& other) noexcept;
+    mapped_file_t& operator=(mapped_file_t&& other) noexcept;
+    mapped_file_t(const mapped_file_t&) = delete;
+    mapped_file_t& operator=(const mapped_file_t&) = delete;
+    ~mapped_file_t();
+
+    bool is_open() const { return _is_open; }
+    bool is_mapped() const { return _mapping != nullptr; }
+
+    std::string_view data() const { return _data; }
+    lines_t lines() const { return lines_t(_data); }
+
+private:
+    void read_fd(int fd);
+    void unmap();
+
+    void* _mapping = nullptr;
+    size_t _mapping_size = 0ul;
+    std::string _buffer;
+    std::string_view _data;
+    bool _is_open = false;
+};
+
+} // namespace io
+} // namespace advent
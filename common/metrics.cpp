@@ -0,0 +1,189 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <sys/resource.h>
+
+namespace advent {
+namespace metrics {
+
+namespace {
+
+struct registry_t {
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<counter_t>> counters;
+    std::map<std::string, std::unique_ptr<histogram_t>> histograms;
+    std::map<std::string, std::unique_ptr<histogram_t>> timers;
+    std::string report_path;
+};
+
+registry_t& registry() {
+    // never destroyed, so metrics stay valid while other statics are torn down at exit
+    static auto r = new registry_t();
+    return *r;
+}
+
+template <typename T>
+T& find_or_add(std::map<std::string, std::unique_ptr<T>>& metrics, const std::string& name) {
+    auto& m = metrics[name];
+    if (!m) {
+        m = std::make_unique<T>();
+    }
+    return *m;
+}
+
+void write_histogram(std::ostream& out, const histogram_t& h) {
+    out << "{\"count\": " << h.count() << ", \"sum\": " << h.sum() << ", \"min\": " << h.min()
+        << ", \"p50\": " << h.quantile(0.5) << ", \"p90\": " << h.quantile(0.9) << ", \"p99\": " << h.quantile(0.99)
+        << ", \"max\": " << h.max() << "}";
+}
+
+template <typename M, typename F>
+void write_section(std::ostream& out, const char* name, const M& metrics, F write_value) {
+    out << "  \"" << name << "\": {";
+    const char* sep = "\n";
+    for (const auto& [key, value] : metrics) {
+        out << sep << "    \"" << key << "\": ";
+        write_value(value);
+        sep = ",\n";
+    }
+    out << (metrics.empty() ? "}" : "\n  }");
+}
+
+void write_report() {
+    auto& path = registry().report_path;
+    if (path == "-") {
+        write_json(std::cout);
+        return;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot open metrics file " << path << std::endl;
+        return;
+    }
+    write_json(out);
+}
+
+} // namespace
+
+size_t counter_t::shard_index() {
+    static std::atomic<size_t> next_thread{0ul};
+    thread_local size_t index = next_thread.fetch_add(1ul, std::memory_order_relaxed) % num_shards;
+    return index;
+}
+
+uint64_t counter_t::value() const {
+    uint64_t total = 0ull;
+    for (const auto& s : _shards) {
+        total += s.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+size_t histogram_t::bucket_index(uint64_t v) {
+    if (v < 16ull) {
+        return static_cast<size_t>(v);
+    }
+    auto msb = 63 - __builtin_clzll(v);
+    auto sub = (v >> (msb - 4)) & 15ull;
+    return static_cast<size_t>((msb - 3) * 16) + static_cast<size_t>(sub);
+}
+
+uint64_t histogram_t::bucket_lower_bound(size_t index) {
+    if (index < 16ul) {
+        return index;
+    }
+    auto msb = index / 16ul + 3ul;
+    return (16ull + index % 16ul) << (msb - 4ul);
+}
+
+void histogram_t::record(uint64_t v) {
+    _buckets[bucket_index(v)].fetch_add(1ull, std::memory_order_relaxed);
+    _count.fetch_add(1ull, std::memory_order_relaxed);
+    _sum.fetch_add(v, std::memory_order_relaxed);
+
+    auto cur_min = _min.load(std::memory_order_relaxed);
+    while (v < cur_min && !_min.compare_exchange_weak(cur_min, v, std::memory_order_relaxed)) {}
+    auto cur_max = _max.load(std::memory_order_relaxed);
+    while (v > cur_max && !_max.compare_exchange_weak(cur_max, v, std::memory_order_relaxed)) {}
+}
+
+uint64_t histogram_t::quantile(double q) const {
+    auto total = count();
+    if (total == 0ull) {
+        return 0ull;
+    }
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1ull)) + 1ull;
+    uint64_t seen = 0ull;
+    for (size_t i = 0ul; i < num_buckets; i++) {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::max(bucket_lower_bound(i), min());
+        }
+    }
+    return max();
+}
+
+counter_t& counter(const std::string& name) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return find_or_add(r.counters, name);
+}
+
+histogram_t& histogram(const std::string& name) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return find_or_add(r.histograms, name);
+}
+
+histogram_t& timer(const std::string& name) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return find_or_add(r.timers, name);
+}
+
+uint64_t peak_rss_bytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0ull;
+    }
+    // ru_maxrss is in kilobytes on Linux
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024ull;
+}
+
+void write_json(std::ostream& out) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    out << "{\n";
+    out << "  \"enabled\": " << (ADVENT_METRICS ? "true" : "false") << ",\n";
+    out << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n";
+    write_section(out, "counters", r.counters, [&out](const auto& c) { out << c->value(); });
+    out << ",\n";
+    write_section(out, "timers_ns", r.timers, [&out](const auto& h) { write_histogram(out, *h); });
+    out << ",\n";
+    write_section(out, "histograms", r.histograms, [&out](const auto& h) { write_histogram(out, *h); });
+    out << "\n}\n";
+}
+
+void report_at_exit(const std::string& path) {
+    auto& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.report_path.empty()) {
+            r.report_path = path;
+            return;
+        }
+        r.report_path = path;
+    }
+    std::atexit(write_report);
+}
+
+} // namespace metrics
+} // namespace advent
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Hot-path instrumentation. Configure with -DADVENT_METRICS=ON to enable; otherwise every
+// ADVENT_METRICS_* macro expands to nothing and instrumented code is unchanged.
+#ifndef ADVENT_METRICS
+#define ADVENT_METRICS 0
+#endif
+
+namespace advent {
+namespace metrics {
+
+// Monotonic counter. Increments land in one of several cache-line sized shards picked per thread, so
+// counters bumped from parallel_line_reduce workers do not all fight over one line.
+class counter_t {
+public:
+    void add(uint64_t n) { _shards[shard_index()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    static constexpr size_t num_shards = 16ul;
+
+    struct alignas(64) shard_t {
+        std::atomic<uint64_t> value{0ull};
+    };
+
+    static size_t shard_index();
+
+    std::array<shard_t, num_shards> _shards;
+};
+
+// Log-linear histogram: exact below 16, then 16 sub-buckets per power of two (at most 6.25% error)
+// across the full 64-bit range.
+class histogram_t {
+public:
+    static constexpr size_t num_buckets = 16ul + 60ul * 16ul;
+
+    void record(uint64_t v);
+
+    uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+    uint64_t min() const { return count() ? _min.load(std::memory_order_relaxed) : 0ull; }
+    uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+    // lower bound of the bucket holding the q-quantile (0 <= q <= 1)
+    uint64_t quantile(double q) const;
+
+    static size_t bucket_index(uint64_t v);
+    static uint64_t bucket_lower_bound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, num_buckets> _buckets{};
+    std::atomic<uint64_t> _count{0ull};
+    std::atomic<uint64_t> _sum{0ull};
+    std::atomic<uint64_t> _min{~0ull};
+    std::atomic<uint64_t> _max{0ull};
+};
+
+// Named metrics live for the whole process; the returned references stay valid.
+counter_t& counter(const std::string& name);
+histogram_t& histogram(const std::string& name);
+// A timer is a histogram of nanosecond durations, reported separately from plain histograms.
+histogram_t& timer(const std::string& name);
+
+class scoped_timer_t {
+public:
+    explicit scoped_timer_t(histogram_t& timer) : _timer(timer), _start(std::chrono::steady_clock::now()) {}
+    scoped_timer_t(const scoped_timer_t&) = delete;
+    scoped_timer_t& operator=(const scoped_timer_t&) = delete;
+    ~scoped_timer_t() {
+        auto elapsed = std::chrono::steady_clock::now() - _start;
+        _timer.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+private:
+    histogram_t& _timer;
+    std::chrono::steady_clock::time_point _start;
+};
+
+// Peak resident set size of the process so far.
+uint64_t peak_rss_bytes();
+
+// Writes every metric and the peak RSS as one JSON object.
+void write_json(std::ostream& out);
+
+// Writes the JSON report to `path` ("-" for stdout) when the process exits.
+void report_at_exit(const std::string& path);
+
+} // namespace metrics
+} // namespace advent
+
+#define ADVENT_METRICS_CONCAT_IMPL(a, b) a##b
+#define ADVENT_METRICS_CONCAT(a, b) ADVENT_METRICS_CONCAT_IMPL(a, b)
+
+#if ADVENT_METRICS
+
+// Times the rest of the enclosing scope into the timer `name` (a string literal).
+#define ADVENT_METRICS_TIMER(name) \
+    static ::advent::metrics::histogram_t& ADVENT_METRICS_CONCAT(advent_timer_site_, __LINE__) = \
+        ::advent::metrics::timer(name); \
+    ::advent::metrics::scoped_timer_t ADVENT_METRICS_CONCAT(advent_timer_, __LINE__)( \
+        ADVENT_METRICS_CONCAT(advent_timer_site_, __LINE__))
+
+// Adds `n` to the counter `name` (a string literal).
+#define ADVENT_METRICS_COUNT(name, n) \
+    do { \
+        static ::advent::metrics::counter_t& advent_counter_site_ = ::advent::metrics::counter(name); \
+        advent_counter_site_.add(n); \
+    } while (0)
+
+// Records `value` into the histogram `name` (a string literal).
+#define ADVENT_METRICS_RECORD(name, value) \
+    do { \
+        static ::advent::metrics::histogram_t& advent_histogram_site_ = ::advent::metrics::histogram(name); \
+        advent_histogram_site_.record(value); \
+    } while (0)
+
+#else
+
+#define ADVENT_METRICS_TIMER(name) static_cast<void>(0)
+#define ADVENT_METRICS_COUNT(name, n) static_cast<void>(0)
+#define ADVENT_METRICS_RECORD(name, value) static_cast<void>(0)
+
+#endif
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include <cassert>
+
+namespace advent {
+namespace numbers {
+
+// Mirrors std::from_chars_result, plus the value, so reads can be chained from `ptr`.
+template <typename T>
+struct parse_result_t {
+    T value;
+    const char* ptr;
+    std::errc ec;
+
+    explicit operator bool() const { return ec == std::errc(); }
+};
+
+namespace detail {
+
+inline uint64_t load8(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Number of leading ASCII digits in the little endian word `v` (0..8).
+inline int count_digits8(uint64_t v) {
+    // digit bytes become 0; any byte after a non-digit may be disturbed by the +6 carry, which is fine
+    // since only the first non-digit matters
+    uint64_t t = ((v & 0xf0f0f0f0f0f0f0f0ull) | (((v + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) >> 4))
+        ^ 0x3333333333333333ull;
+    uint64_t nonzero = (((t & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | t) & 0x8080808080808080ull;
+    return nonzero ? __builtin_ctzll(nonzero) >> 3 : 8;
+}
+
+// Value of the first `n` (1..8) digits of the little endian word `v`.
+inline uint64_t parse_digits8(uint64_t v, int n) {
+    v -= 0x3030303030303030ull;
+    // shift the digits up so the unused low bytes act as leading zeros
+    v <<= 8 * (8 - n);
+    v = (v * 10ull) + (v >> 8);
+    v = (((v & 0x000000ff000000ffull) * (100ull + (1000000ull << 32)))
+         + (((v >> 16) & 0x000000ff000000ffull) * (1ull + (10000ull << 32)))) >> 32;
+    return v;
+}
+
+constexpr uint64_t pow10[9] = {1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull};
+
+template <typename T>
+parse_result_t<T> parse_unsigned(const char* first, const char* last) {
+    if (last - first >= 8) {
+        // SWAR fast path for runs of up to 16 digits; longer runs may overflow and go through from_chars
+        auto lo = load8(first);
+        auto n = count_digits8(lo);
+        if (n == 0) {
+            return {T{}, first, std::errc::invalid_argument};
+        }
+
+        uint64_t value = parse_digits8(lo, n);
+        bool done = n < 8;
+        if (!done && last - first >= 16) {
+            auto hi = load8(first + 8);
+            if (auto m = count_digits8(hi); m < 8) {
+                value = value * pow10[m] + (m ? parse_digits8(hi, m) : 0ull);
+                n += m;
+                done = true;
+            }
+        }
+
+        if (done) {
+            if (value > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+                return {T{}, first + n, std::errc::result_out_of_range};
+            }
+            return {static_cast<T>(value), first + n, std::errc()};
+        }
+    }
+
+    T value{};
+    auto res = std::from_chars(first, last, value);
+    return {value, res.ptr, res.ec};
+}
+
+} // namespace detail
+
+// Parses an integer at the start of [first, last). Unlike std::stoi there is no whitespace skipping,
+// no locale and no allocation; `ptr` points one past the last digit consumed.
+template <typename T>
+parse_result_t<T> parse(const char* first, const char* last) {
+    static_assert(std::is_integral_v<T>);
+    if constexpr (std::is_signed_v<T>) {
+        if (first != last && *first == '-') {
+            using U = std::make_unsigned_t<T>;
+            auto res = detail::parse_unsigned<U>(first + 1, last);
+            if (!res) {
+                return {T{}, res.ec == std::errc::invalid_argument ? first : res.ptr, res.ec};
+            }
+            if (res.value > static_cast<U>(std::numeric_limits<T>::max()) + 1u) {
+                return {T{}, res.ptr, std::errc::result_out_of_range};
+            }
+            return {static_cast<T>(U{0} - res.value), res.ptr, std::errc()};
+        }
+        auto res = detail::parse_unsigned<std::make_unsigned_t<T>>(first, last);
+        if (res && res.value > static_cast<std::make_unsigned_t<T>>(std::numeric_limits<T>::max())) {
+            return {T{}, res.ptr, std::errc::result_out_of_range};
+        }
+        return {static_cast<T>(res.value), res.ptr, res.ec};
+    } else {
+        return detail::parse_unsigned<T>(first, last);
+    }
+}
+
+template <typename T>
+parse_result_t<T> parse(std::string_view s) {
+    return parse<T>(s.data(), s.data() + s.size());
+}
+
+// Skips leading spaces, then parses; for reading whitespace separated columns one after another.
+template <typename T>
+parse_result_t<T> parse_next(const char* first, const char* last) {
+    while (first != last && *first == ' ') {
+        first++;
+    }
+    return parse<T>(first, last);
+}
+
+// Parses a whole field that is known to hold a number.
+template <typename T>
+T to_number(std::string_view s) {
+    [[maybe_unused]] auto res = parse<T>(s);
+    assert(res);
+    return res.value;
+}
+
+} // namespace numbers
+} // namespace advent
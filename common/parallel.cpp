@@ -0,0 +1,51 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace advent {
+namespace parallel {
+
+namespace {
+
+// below this, another thread costs more than it saves
+constexpr size_t min_chunk_size = 1ul << 18;
+
+std::atomic<size_t> configured_threads{0ul};
+
+} // namespace
+
+size_t num_threads() {
+    if (auto n = configured_threads.load(std::memory_order_relaxed)) {
+        return n;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void set_num_threads(size_t n) {
+    configured_threads.store(n, std::memory_order_relaxed);
+}
+
+std::vector<std::string_view> split_lines(std::string_view buffer, size_t max_chunks) {
+    std::vector<std::string_view> chunks;
+    if (buffer.empty()) {
+        return chunks;
+    }
+
+    auto num_chunks = std::clamp(buffer.size() / min_chunk_size, size_t(1), std::max(max_chunks, size_t(1)));
+    size_t start = 0ul;
+    for (size_t i = 1ul; i <= num_chunks && start < buffer.size(); i++) {
+        size_t end = buffer.size();
+        if (i < num_chunks) {
+            auto target = std::max(start, buffer.size() / num_chunks * i);
+            auto newline = buffer.find('\n', target);
+            end = newline == std::string_view::npos ? buffer.size() : newline + 1ul;
+        }
+        chunks.push_back(buffer.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
+
+} // namespace parallel
+} // namespace advent
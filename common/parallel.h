@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace advent {
+namespace parallel {
+
+// Worker threads used by the parallel helpers; defaults to the hardware concurrency.
+size_t num_threads();
+void set_num_threads(size_t n);
+
+// Splits `buffer` into at most `max_chunks` contiguous pieces that each end just after a newline (or at
+// the end of the buffer), so no line straddles two chunks. Small buffers get fewer chunks so threads
+// are only started when there is enough work to pay for them.
+std::vector<std::string_view> split_lines(std::string_view buffer, size_t max_chunks);
+
+namespace detail {
+
+// Runs `task(i)` for i in [0, n): task 0 on the calling thread, the rest on threads of their own. If tasks
+// throw, every task still finishes and the exception of the lowest-numbered one is rethrown here.
+template <typename Task>
+void run_tasks(size_t n, Task& task) {
+    std::vector<std::exception_ptr> errors(n);
+    auto guarded = [&task, &errors](size_t i) {
+        try {
+            task(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1ul; i < n; i++) {
+        threads.emplace_back(guarded, i);
+    }
+    if (n > 0ul) {
+        guarded(0ul);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    for (const auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+} // namespace detail
+
+// Calls `f(chunk)` for every chunk of split_lines(buffer, num_threads()), each chunk on its own thread,
+// and returns the results in buffer order. `f` is shared by the threads, so it must be safe to call
+// concurrently.
+template <typename F>
+auto parallel_map_chunks(std::string_view buffer, F f) -> std::vector<std::invoke_result_t<F&, std::string_view>> {
+    auto chunks = split_lines(buffer, num_threads());
+    std::vector<std::invoke_result_t<F&, std::string_view>> results(chunks.size());
+
+    auto map_chunk = [&](size_t i) {
+        results[i] = f(chunks[i]);
+    };
+    detail::run_tasks(chunks.size(), map_chunk);
+    return results;
+}
+
+// Splits [0, count) into at most num_threads() contiguous ranges of at least `min_size` items (bar the
+// only range of a smaller count), calls `f(begin, end)` for each on its own thread and returns the
+// results in order. As with parallel_map_chunks, `f` must be safe to call concurrently.
+template <typename F>
+auto parallel_map_range(size_t count, size_t min_size, F f) -> std::vector<std::invoke_result_t<F&, size_t, size_t>> {
+    auto num_ranges = count == 0ul ? 0ul : std::clamp(count / std::max(min_size, size_t(1)), size_t(1), num_threads());
+    std::vector<std::invoke_result_t<F&, size_t, size_t>> results(num_ranges);
+
+    auto map_range = [&](size_t i) {
+        results[i] = f(count * i / num_ranges, count * (i + 1ul) / num_ranges);
+    };
+    detail::run_tasks(num_ranges, map_range);
+    return results;
+}
+
+// Maps every line of `buffer` to a T and folds the results with `combine`, which together with
+// `identity` must form a monoid: chunks are reduced on their own threads and the per-thread partials
+// are combined in order. Each thread gets its own copy of `map`, so a mutable map may keep scratch
+// state between lines.
+template <typename T, typename Map, typename Combine>
+T parallel_line_reduce(std::string_view buffer, T identity, Map map, Combine combine) {
+    auto partials = parallel_map_chunks(buffer, [&](std::string_view chunk) {
+        auto chunk_map = map;
+        T acc = identity;
+        for (auto line : io::lines_t(chunk)) {
+            acc = combine(std::move(acc), chunk_map(line));
+        }
+        return acc;
+    });
+
+    T result = std::move(identity);
+    for (auto& p : partials) {
+        result = combine(std::move(result), std::move(p));
+    }
+    return result;
+}
+
+} // namespace parallel
+} // namespace advent
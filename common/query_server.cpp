@@ -0,0 +1,227 @@
+#include "query_server.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+namespace advent {
+namespace server {
+
+namespace {
+
+void report(const serve_stats_t& stats) {
+    std::fprintf(stderr, "Served %llu queries in %llu batches; latency p50 %.1f us  p90 %.1f us  p99 %.1f us  max %.1f us\n",
+                 static_cast<unsigned long long>(stats.queries), static_cast<unsigned long long>(stats.batches),
+                 stats.p50_ns / 1e3, stats.p90_ns / 1e3, stats.p99_ns / 1e3, stats.max_ns / 1e3);
+}
+
+} // namespace
+
+serve_stats_t serve_fd(int in_fd, int out_fd, const handler_t& handler) {
+    // Requests are read while responses wait, so a client that sends everything before reading anything back
+    // cannot fill both directions and deadlock. The responses it has not read are held here; beyond this
+    // much the client is dropped instead.
+    constexpr size_t max_unsent = 256ul << 20;
+
+    metrics::histogram_t latency;
+    serve_stats_t stats;
+
+    // the writes must never block, or a client not reading yet would stall the reads it is waiting on
+    int out_flags = ::fcntl(out_fd, F_GETFL);
+    if (out_flags >= 0) {
+        ::fcntl(out_fd, F_SETFL, out_flags | O_NONBLOCK);
+    }
+
+    size_t capacity = 64ul * 1024ul;
+    std::unique_ptr<char[]> buffer(new char[capacity]);
+    size_t end = 0ul;
+    std::vector<std::string_view> requests;
+    // responses queued for the client, of which the first `sent` bytes are written
+    std::string responses;
+    size_t sent = 0ul;
+    // batches with responses still in `responses`, oldest first
+    struct pending_batch_t {
+        size_t end;
+        size_t queries;
+        std::chrono::steady_clock::time_point received;
+    };
+    std::deque<pending_batch_t> pending;
+    bool eof = false;
+    while (true) {
+        auto unsent = responses.size() - sent;
+        if (unsent > max_unsent) {
+            std::fprintf(stderr, "Dropping a client with %zu bytes of responses unread\n", unsent);
+            break;
+        }
+        auto reading = !eof;
+        if (!reading && unsent == 0ul) {
+            break;
+        }
+
+        pollfd fds[2];
+        nfds_t num_fds = 0ul;
+        auto out_events = static_cast<short>(unsent > 0ul ? POLLOUT : 0);
+        if (in_fd == out_fd) {
+            fds[num_fds++] = {in_fd, static_cast<short>((reading ? POLLIN : 0) | out_events), 0};
+        } else {
+            if (reading) {
+                fds[num_fds++] = {in_fd, POLLIN, 0};
+            }
+            if (unsent > 0ul) {
+                fds[num_fds++] = {out_fd, out_events, 0};
+            }
+        }
+        if (::poll(fds, num_fds, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        auto readable = reading && (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+
+        if (readable) {
+            if (end == capacity) {
+                // one request fills the whole buffer
+                std::unique_ptr<char[]> grown(new char[capacity * 2ul]);
+                std::memcpy(grown.get(), buffer.get(), end);
+                buffer = std::move(grown);
+                capacity *= 2ul;
+            }
+            auto n = ::read(in_fd, buffer.get() + end, capacity - end);
+            auto received = std::chrono::steady_clock::now();
+            if (n >= 0 || (errno != EINTR && errno != EAGAIN)) {
+                eof = n <= 0;
+                auto scanned = end;
+                end += eof ? 0ul : static_cast<size_t>(n);
+
+                // every complete line is a request; at the end of input, so is a last line without a newline
+                requests.clear();
+                size_t begin = 0ul;
+                auto data = buffer.get();
+                for (auto p = data + scanned;;) {
+                    auto newline = static_cast<const char*>(std::memchr(p, '\n', data + end - p));
+                    if (newline == nullptr) {
+                        break;
+                    }
+                    requests.emplace_back(data + begin, newline - (data + begin));
+                    begin = static_cast<size_t>(newline - data) + 1ul;
+                    p = data + begin;
+                }
+                if (eof && begin < end) {
+                    requests.emplace_back(data + begin, end - begin);
+                    begin = end;
+                }
+
+                if (!requests.empty()) {
+                    handler(requests, responses);
+                    pending.push_back({responses.size(), requests.size(), received});
+                    ADVENT_METRICS_RECORD("server.batch_size", requests.size());
+                    stats.batches++;
+                }
+
+                std::memmove(data, data + begin, end - begin);
+                end -= begin;
+            }
+        }
+
+        // write whatever the client takes now, whether or not poll() reported it ready
+        if (sent < responses.size()) {
+            auto n = ::write(out_fd, responses.data() + sent, responses.size() - sent);
+            if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                break;
+            }
+            sent += n > 0 ? static_cast<size_t>(n) : 0ul;
+        }
+        auto now = std::chrono::steady_clock::now();
+        for (; !pending.empty() && pending.front().end <= sent; pending.pop_front()) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - pending.front().received);
+            for (size_t i = 0ul; i < pending.front().queries; i++) {
+                latency.record(static_cast<uint64_t>(elapsed.count()));
+            }
+        }
+        // drop the written prefix once it is all there is, or large enough to be worth the move
+        if (sent == responses.size() || sent >= (1ul << 20)) {
+            responses.erase(0ul, sent);
+            for (auto& batch : pending) {
+                batch.end -= sent;
+            }
+            sent = 0ul;
+        }
+    }
+
+    if (out_flags >= 0) {
+        ::fcntl(out_fd, F_SETFL, out_flags);
+    }
+    stats.queries = latency.count();
+    stats.p50_ns = latency.quantile(0.5);
+    stats.p90_ns = latency.quantile(0.9);
+    stats.p99_ns = latency.quantile(0.99);
+    stats.max_ns = latency.max();
+    return stats;
+}
+
+bool serve(const std::string& endpoint, const handler_t& handler) {
+    // a client hanging up mid-response must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (endpoint == "-") {
+        report(serve_fd(STDIN_FILENO, STDOUT_FILENO, handler));
+        return true;
+    }
+
+    sockaddr_un address{};
+    if (endpoint.size() >= sizeof(address.sun_path)) {
+        std::fprintf(stderr, "Socket path too long: %s\n", endpoint.c_str());
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1ul);
+
+    // replace a socket left behind by an earlier server, but never any other kind of file
+    struct stat st;
+    if (::lstat(endpoint.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(endpoint.c_str());
+    }
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listener, 16) != 0) {
+        std::fprintf(stderr, "Cannot listen on %s: %s\n", endpoint.c_str(), std::strerror(errno));
+        if (listener >= 0) {
+            ::close(listener);
+        }
+        return false;
+    }
+    std::fprintf(stderr, "Listening on %s\n", endpoint.c_str());
+
+    while (true) {
+        int connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::fprintf(stderr, "accept failed: %s\n", std::strerror(errno));
+            break;
+        }
+        report(serve_fd(connection, connection, handler));
+        ::close(connection);
+    }
+    ::close(listener);
+    return false;
+}
+
+} // namespace server
+} // namespace advent
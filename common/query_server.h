@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace advent {
+namespace server {
+
+// Answers a batch of request lines, appending exactly one '\n' terminated response line per request to
+// `responses`, in request order.
+using handler_t = std::function<void(const std::vector<std::string_view>& requests, std::string& responses)>;
+
+// What one connection (or the whole of stdin) was served.
+struct serve_stats_t {
+    uint64_t queries = 0ull;
+    uint64_t batches = 0ull;
+    // per-query latency from the read that completed the request to the write that finished its response
+    uint64_t p50_ns = 0ull;
+    uint64_t p90_ns = 0ull;
+    uint64_t p99_ns = 0ull;
+    uint64_t max_ns = 0ull;
+};
+
+// Reads request lines from `in_fd` until end of input and writes the responses to `out_fd`. Clients may
+// pipeline: every complete line that one read returns goes to `handler` as a single batch. Responses are
+// written as fast as the client takes them, without blocking, and requests are read meanwhile, so a
+// client that sends a large batch before reading any of it is still served. A client leaving more than
+// 256 MiB of responses unread is dropped.
+serve_stats_t serve_fd(int in_fd, int out_fd, const handler_t& handler);
+
+// Serves `endpoint` with `handler`: "-" reads requests from stdin and answers on stdout until end of input;
+// anything else is the path of a Unix domain socket to listen on, serving one connection at a time until
+// the process is stopped. The stats of each connection are reported on stderr. Returns false if the
+// endpoint cannot be set up.
+bool serve(const std::string& endpoint, const handler_t& handler);
+
+} // namespace server
+} // namespace advent
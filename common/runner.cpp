@@ -0,0 +1,66 @@
+#include "runner.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <cassert>
+
+namespace advent {
+namespace runner {
+
+registry_t& registry_t::instance() {
+    static registry_t registry;
+    return registry;
+}
+
+bool registry_t::add(day_t&& day) {
+    assert(day.parse && day.part1 && day.part2);
+    auto key = day.day;
+    [[maybe_unused]] auto insert_res = _days.emplace(key, std::move(day));
+    assert(insert_res.second);
+    return true;
+}
+
+bool registry_t::add_stream(int day,
+                            std::function<std::pair<std::string, std::string>(io::line_reader_t&)> stream) {
+    auto itr = _days.find(day);
+    assert(itr != _days.end() && !itr->second.stream);
+    itr->second.stream = std::move(stream);
+    return true;
+}
+
+bool registry_t::add_server(int day, std::function<server::handler_t(std::string_view)> serve) {
+    auto itr = _days.find(day);
+    assert(itr != _days.end() && !itr->second.serve);
+    itr->second.serve = std::move(serve);
+    return true;
+}
+
+const day_t* registry_t::find(int day) const {
+    if (auto itr = _days.find(day); itr != _days.end()) {
+        return &itr->second;
+    }
+    return nullptr;
+}
+
+phase_stats_t summarize(std::vector<double> samples) {
+    if (samples.empty()) {
+        return {};
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // nearest-rank percentiles
+    auto rank = [&samples](double p) {
+        auto r = static_cast<size_t>(std::ceil(p * samples.size()));
+        return samples[std::clamp(r, size_t(1), samples.size()) - 1ul];
+    };
+
+    phase_stats_t stats;
+    stats.min = samples.front();
+    stats.median = rank(0.5);
+    stats.p99 = rank(0.99);
+    return stats;
+}
+
+} // namespace runner
+} // namespace advent
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "line_reader.h"
+#include "metrics.h"
+#include "query_server.h"
+
+namespace advent {
+namespace runner {
+
+// Type-erased entry points for one day. `parse` turns the whole input buffer into the day's state;
+// `part1` and `part2` compute an answer from that state. The state may reference the input buffer,
+// so the buffer must outlive it.
+//
+// `stream` is optional: a single pass over the input, line by line, that returns both answers while holding
+// only the state the day actually needs.
+//
+// `serve` is optional too: it prepares the input once and returns a handler answering queries against it for
+// as long as the server runs.
+struct day_t {
+    int day = 0;
+    std::string default_input;
+    std::function<std::shared_ptr<void>(std::string_view)> parse;
+    std::function<std::string(void*)> part1;
+    std::function<std::string(void*)> part2;
+    std::function<std::pair<std::string, std::string>(io::line_reader_t&)> stream;
+    std::function<server::handler_t(std::string_view)> serve;
+};
+
+class registry_t {
+public:
+    static registry_t& instance();
+
+    bool add(day_t&& day);
+    bool add_stream(int day, std::function<std::pair<std::string, std::string>(io::line_reader_t&)> stream);
+    bool add_server(int day, std::function<server::handler_t(std::string_view)> serve);
+    const day_t* find(int day) const;
+    const std::map<int, day_t>& days() const { return _days; }
+
+private:
+    registry_t() = default;
+
+    std::map<int, day_t> _days;
+};
+
+// Summary of the wall time samples collected for one phase across repeats, in seconds.
+struct phase_stats_t {
+    double min = 0.0;
+    double median = 0.0;
+    double p99 = 0.0;
+};
+
+phase_stats_t summarize(std::vector<double> samples);
+
+// Wall time of one call of `f`, in seconds.
+template <typename F>
+double time_phase(F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+namespace detail {
+
+// Wraps an entry point so each call is recorded in the metrics timer `name`; a no-op without metrics.
+template <typename F>
+auto timed(const std::string& name, F f) {
+#if ADVENT_METRICS
+    auto& timer = metrics::timer(name);
+    return [&timer, f](auto&&... args) {
+        metrics::scoped_timer_t scope(timer);
+        return f(std::forward<decltype(args)>(args)...);
+    };
+#else
+    static_cast<void>(name);
+    return f;
+#endif
+}
+
+template <typename T>
+std::string to_answer(T&& value) {
+    if constexpr (std::is_convertible_v<T, std::string>) {
+        return std::string(std::forward<T>(value));
+    } else {
+        return std::to_string(value);
+    }
+}
+
+} // namespace detail
+
+// Registers a day with the runner. `parse` is called as `state_t parse(std::string_view input)`; `part1`
+// and `part2` are called with a `state_t&` and may return any integral type or string.
+template <typename Parse, typename Part1, typename Part2>
+bool register_day(int day, std::string default_input, Parse parse, Part1 part1, Part2 part2) {
+    using state_t = std::invoke_result_t<Parse, std::string_view>;
+
+    day_t entry;
+    entry.day = day;
+    entry.default_input = std::move(default_input);
+    auto prefix = "day" + std::to_string(day);
+    entry.parse = detail::timed(prefix + ".parse", [parse](std::string_view input) -> std::shared_ptr<void> {
+        return std::make_shared<state_t>(parse(input));
+    });
+    entry.part1 = detail::timed(prefix + ".part1", [part1](void* state) {
+        return detail::to_answer(part1(*static_cast<state_t*>(state)));
+    });
+    entry.part2 = detail::timed(prefix + ".part2", [part2](void* state) {
+        return detail::to_answer(part2(*static_cast<state_t*>(state)));
+    });
+    return registry_t::instance().add(std::move(entry));
+}
+
+// Registers the streaming solver of a day that is already registered. `solve` is called as
+// `std::pair<A, B> solve(io::line_reader_t& lines)` where A and B are any integral type or string.
+template <typename Solve>
+bool register_stream(int day, Solve solve) {
+    auto timed_solve = detail::timed("day" + std::to_string(day) + ".stream", [solve](io::line_reader_t& lines) {
+        auto answers = solve(lines);
+        return std::make_pair(detail::to_answer(answers.first), detail::to_answer(answers.second));
+    });
+    return registry_t::instance().add_stream(day, std::move(timed_solve));
+}
+
+// Registers the query server of a day that is already registered. `make_handler` is called once as
+// `server::handler_t make_handler(std::string_view input)`; the input outlives the handler.
+template <typename MakeHandler>
+bool register_server(int day, MakeHandler make_handler) {
+    auto timed_make = detail::timed("day" + std::to_string(day) + ".serve", [make_handler](std::string_view input) {
+        return server::handler_t(make_handler(input));
+    });
+    return registry_t::instance().add_server(day, std::move(timed_make));
+}
+
+} // namespace runner
+} // namespace advent
+
+// Registers a day from its translation unit. ADVENT_INPUT_FILE is set per day by the build and points at
+// the day's checked-in input.
+#define ADVENT_REGISTER_DAY(day, parse, part1, part2) \
+    static const bool advent_day_registered_ = \
+        ::advent::runner::register_day(day, ADVENT_INPUT_FILE, parse, part1, part2)
+
+// Registers a day's streaming solver; must follow the ADVENT_REGISTER_DAY of the same day in its translation unit.
+#define ADVENT_REGISTER_STREAM(day, solve) \
+    static const bool advent_stream_registered_ = ::advent::runner::register_stream(day, solve)
+
+// Registers a day's query server; must follow the ADVENT_REGISTER_DAY of the same day in its translation unit.
+#define ADVENT_REGISTER_SERVER(day, make_handler) \
+    static const bool advent_server_registered_ = ::advent::runner::register_server(day, make_handler)
@@ -1,36 +1,19 @@
 #include "strings.h"
 
-#include <algorithm>
-#include <sstream>
-
 namespace advent {
 namespace strings {
 
-std::vector<std::string> split(const std::string& s, char delim, bool trim) {
-    std::vector<std::string> elems;
-    std::stringstream ss(s);
-    std::string elem;
-    while(std::getline(ss, elem, delim)) {
-        if (elem.size() > 1 || elem[0] != delim) {
-            if (trim) {
-                elems.push_back(advent::strings::trim(elem));
-            } else {
-                elems.push_back(elem);
-            }
-        }
+std::string_view trim(std::string_view s) {
+    size_t first = 0ul;
+    while (first < s.size() && is_space(s[first])) {
+        first++;
     }
-    return elems;
-}
-
-std::string& trim(std::string& s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }));
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }).base(), s.end());
-    return s;
+    size_t last = s.size();
+    while (last > first && is_space(s[last - 1ul])) {
+        last--;
+    }
+    return s.substr(first, last - first);
 }
 
 } // namespce string
-} // namesapce advent
\ No newline at end of file
+} // namesapce advent
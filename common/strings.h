@@ -1,14 +1,106 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
 
 namespace advent {
 namespace strings {
 
-std::vector<std::string> split(const std::string& s, char delim, bool trim = false);
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
 
-std::string& trim(std::string& s);
+std::string_view trim(std::string_view s);
+
+// Lazily splits a string_view on any of the characters in `delims`. Tokens are views into the
+// original string, so nothing is copied or allocated; the viewed string must outlive the tokenizer.
+class tokenizer_t {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = const std::string_view&;
+
+        iterator() = default;
+
+        reference operator*() const { return _token; }
+        pointer operator->() const { return &_token; }
+
+        iterator& operator++() {
+            advance();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            auto tmp = *this;
+            advance();
+            return tmp;
+        }
+
+        bool operator==(const iterator& other) const {
+            return _tokenizer == other._tokenizer
+                && (!_tokenizer || (_rest.data() == other._rest.data() && _done == other._done));
+        }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class tokenizer_t;
+
+        explicit iterator(const tokenizer_t* tokenizer) : _tokenizer(tokenizer), _rest(tokenizer->_s) {
+            advance();
+        }
+
+        void advance() {
+            while (_tokenizer) {
+                if (_done) {
+                    _tokenizer = nullptr;
+                    return;
+                }
+
+                auto pos = _rest.find_first_of(_tokenizer->_delims);
+                if (pos == std::string_view::npos) {
+                    _token = _rest;
+                    _done = true;
+                } else {
+                    _token = _rest.substr(0, pos);
+                    _rest.remove_prefix(pos + 1);
+                }
+
+                if (_tokenizer->_trim) {
+                    _token = strings::trim(_token);
+                }
+                if (!_tokenizer->_skip_empty || !_token.empty()) {
+                    return;
+                }
+            }
+        }
+
+        const tokenizer_t* _tokenizer = nullptr;
+        std::string_view _rest;
+        std::string_view _token;
+        bool _done = false;
+    };
+
+    tokenizer_t(std::string_view s, std::string_view delims, bool trim = false, bool skip_empty = false)
+        : _s(s), _delims(delims), _trim(trim), _skip_empty(skip_empty) {}
+
+    iterator begin() const { return iterator(this); }
+    iterator end() const { return iterator(); }
+
+private:
+    std::string_view _s;
+    std::string_view _delims;
+    bool _trim;
+    bool _skip_empty;
+};
+
+inline tokenizer_t tokenize(std::string_view s, std::string_view delims, bool trim = false, bool skip_empty = false) {
+    return tokenizer_t(s, delims, trim, skip_empty);
+}
 
 } // namespce string
-} // namesapce advent
\ No newline at end of file
+} // namesapce advent